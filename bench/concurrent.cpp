@@ -0,0 +1,119 @@
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <simpleini.h>
+#include <simpleini_concurrent.h>
+
+// Reader and writer scaling of ConcurrentINI against a SimpleINI behind one
+// global std::shared_mutex. Every thread works on its own section, reading
+// values and setting one in every @write_every operations.
+
+namespace {
+
+constexpr int sections = 64;
+constexpr int keys = 16;
+constexpr auto duration = std::chrono::milliseconds(300);
+
+std::string
+section_name(int i)
+{
+    return "section" + std::to_string(i);
+}
+
+simpleini::SimpleINI
+make_config()
+{
+    simpleini::SimpleINI config;
+    for (int s = 0; s < sections; ++s) {
+        for (int k = 0; k < keys; ++k) {
+            config.set(section_name(s), "key" + std::to_string(k), "1234");
+        }
+    }
+    return config;
+}
+
+/// Operations per second of @threads threads running @operation(thread, i)
+template<typename Operation>
+double
+throughput(int threads, Operation operation)
+{
+    std::atomic<bool> stop = false;
+    std::atomic<long> total = 0;
+    std::barrier start(threads + 1);
+    std::vector<std::jthread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            start.arrive_and_wait();
+            long done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                operation(t, done++);
+            }
+            total += done;
+        });
+    }
+    start.arrive_and_wait();
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    workers.clear();
+    return static_cast<double>(total) /
+           std::chrono::duration<double>(duration).count();
+}
+}
+
+int
+main()
+{
+    const std::vector<std::string> names = [] {
+        std::vector<std::string> names;
+        for (int s = 0; s < sections; ++s) {
+            names.push_back(section_name(s));
+        }
+        return names;
+    }();
+    const std::string key = "key3";
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    std::printf("%-8s %-12s %17s %17s\n",
+                "threads",
+                "writes",
+                "concurrent Mop/s",
+                "global lock Mop/s");
+    for (int write_every : { 0, 10 }) {
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            simpleini::ConcurrentINI concurrent{ make_config() };
+            double sharded = throughput(threads, [&](int t, long i) {
+                const auto& section = names[t % sections];
+                if (write_every && i % write_every == 0) {
+                    concurrent.set(section, key, std::to_string(i));
+                } else {
+                    (void)concurrent.get(section, key);
+                }
+            });
+
+            simpleini::SimpleINI config = make_config();
+            std::shared_mutex mutex;
+            double global = throughput(threads, [&](int t, long i) {
+                const auto& section = names[t % sections];
+                if (write_every && i % write_every == 0) {
+                    std::unique_lock lock(mutex);
+                    config.set(section, key, std::to_string(i));
+                } else {
+                    std::shared_lock lock(mutex);
+                    (void)std::string(config[section][key]);
+                }
+            });
+
+            std::printf("%-8d %-12s %17.2f %17.2f\n",
+                        threads,
+                        write_every ? "1 in 10" : "none",
+                        sharded / 1e6,
+                        global / 1e6);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <simpleini.h>
+#include <simpleini_server.h>
+
+// Latency of one lookup through an INIServer against parsing the file for
+// it, as a short lived process without the daemon would. The client is timed
+// both connected once and connecting for every lookup.
+
+namespace {
+
+constexpr auto duration = std::chrono::milliseconds(300);
+
+void
+write_config(const std::filesystem::path& path, int sections, int keys)
+{
+    std::ofstream out(path);
+    for (int s = 0; s < sections; ++s) {
+        out << "[section" << s << "]\n";
+        for (int k = 0; k < keys; ++k) {
+            out << "key" << k << " = value of key " << k << "\n";
+        }
+    }
+}
+
+/// Microseconds per call of @lookup, run for at least @duration
+template<typename Lookup>
+double
+latency(Lookup lookup)
+{
+    using clock = std::chrono::steady_clock;
+    long calls = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    while (elapsed < duration) {
+        lookup();
+        ++calls;
+        elapsed = clock::now() - start;
+    }
+    return std::chrono::duration<double, std::micro>(elapsed).count() /
+           static_cast<double>(calls);
+}
+}
+
+int
+main()
+{
+    const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "simpleini_bench_query";
+    std::filesystem::create_directories(directory);
+    const auto config = directory / "config.ini";
+    const auto socket = directory / "query.sock";
+
+    std::printf("%-8s %-10s %14s %14s %14s\n",
+                "keys",
+                "file KiB",
+                "client us",
+                "connect us",
+                "reparse us");
+    for (int sections : { 1, 10, 100, 1000 }) {
+        constexpr int keys = 100;
+        write_config(config, sections, keys);
+        const std::string section = "section" + std::to_string(sections / 2);
+        const std::string key = "key" + std::to_string(keys / 2);
+
+        simpleini::INIServer server(socket, config);
+        std::thread serving([&server] { server.run(10); });
+
+        simpleini::INIClient client(socket);
+        double connected = latency([&] { (void)client.get(section, key); });
+        double connecting = latency([&] {
+            simpleini::INIClient once(socket);
+            (void)once.get(section, key);
+        });
+        double reparse = latency([&] {
+            simpleini::SimpleINI parsed(config);
+            (void)std::string(parsed[section][key]);
+        });
+
+        server.stop();
+        serving.join();
+
+        std::printf(
+          "%-8d %-10.1f %14.2f %14.2f %14.2f\n",
+          sections * keys,
+          static_cast<double>(std::filesystem::file_size(config)) / 1024,
+          connected,
+          connecting,
+          reparse);
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
@@ -23,18 +23,53 @@ SOFTWARE.
 #ifndef _SIMPLEINI_H
 #define _SIMPLEINI_H
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <exception>
 #include <filesystem>
-#include <fstream>
+#include <iosfwd>
+#include <limits>
 #include <map>
-#include <numeric>
-#include <sstream>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#if !defined(SIMPLEINI_COMPILED) || defined(SIMPLEINI_IMPLEMENTATION)
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#endif
+
+/// Define SIMPLEINI_COMPILED to use the compiled simpleini_compiled library
+/// instead of compiling the parser into every translation unit.
+#ifdef SIMPLEINI_COMPILED
+#define SIMPLEINI_INLINE
+#else
+#define SIMPLEINI_INLINE inline
+#endif
+
+/// Expands to export when included by the simpleini module interface unit.
+#ifndef SIMPLEINI_EXPORT
+#define SIMPLEINI_EXPORT
+#endif
+
 namespace simpleini {
 
-class INIException : public std::runtime_error
+SIMPLEINI_EXPORT class INIException : public std::runtime_error
 {
   public:
     explicit INIException(const std::string& msg)
@@ -42,246 +77,1882 @@ class INIException : public std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
-static bool
-string_is_valid(const std::string& str)
-{
-    if (str.empty() || str.starts_with(';') || str.starts_with('#') ||
-        str.find_first_not_of(' ') == str.npos) {
-        return false;
-    }
-    return true;
-}
-
-static std::string
-parse_section_value(const std::string& str)
-{
-    std::size_t start = 1;
-    std::size_t end = str.find(']');
-    return str.substr(start, end - 1);
-}
-
 /// TODO: strip tabs
-static std::string
-strip_trailing(const std::string& str)
+inline std::string_view
+strip_trailing(std::string_view str)
 {
     std::size_t last_char = str.find_last_not_of(' ');
     return str.substr(0, last_char + 1);
 }
 
 /// TODO: strip tabs
-static std::string
-strip_leading(const std::string& str)
+inline std::string_view
+strip_leading(std::string_view str)
 {
     std::size_t first_char = str.find_first_not_of(' ');
-    return str.substr(first_char, str.length());
+    if (first_char == str.npos) {
+        return {};
+    }
+    return str.substr(first_char);
 }
 
-static std::string
-strip(const std::string& str)
+inline std::string_view
+strip(std::string_view str)
 {
     return strip_leading(strip_trailing(str));
 }
 
-static std::pair<std::string, std::string>
-parse_key_value(const std::string& str)
+constexpr char
+ascii_lower(char c)
 {
-    std::size_t equalpos = str.find('=');
-    std::string key = str.substr(0, equalpos);
-    std::string value = str.substr(equalpos + 1, str.length());
-
-    return { strip(key), strip(value) };
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
 }
 
-class INISection
+/// @brief Ordering for section and key names. Case insensitive ordering folds
+/// ASCII letters while comparing, so the stored names keep their original
+/// spelling and lookups never allocate.
+SIMPLEINI_EXPORT struct key_less
 {
-  public:
-    INISection(){};
-
-    explicit INISection(const std::string& name,
-                        const std::map<std::string, std::string>& content)
-      : m_name(name)
-      , m_contents(content){};
+    using is_transparent = void;
 
-    ~INISection(){};
-
-    /// @brief Returns true if the INISection is empty
-    /// @return boolean
-    [[nodiscard]] bool empty() { return m_contents.empty(); };
-
-    /// @brief Return value of key @key
-    /// @param key the key for the value
-    /// @return string value of key
-    /// @throws std::out_of_range if key doesn't exist
-    std::string operator[](const std::string& key) const { return get(key); };
+    bool case_insensitive = false;
 
-    /// @brief Return value of key @key
-    /// @param key the key for the value
-    /// @return string value of key
-    /// @throws std::out_of_range if key doesn't exist
-    std::string get(const std::string& key) const
+    bool operator()(std::string_view lhs, std::string_view rhs) const
     {
-        if (!m_contents.contains(key)) {
-            throw std::out_of_range("No key '" + key + "' in section '" +
-                                    m_name + "'");
+        if (!case_insensitive) {
+            return lhs < rhs;
         }
-        return m_contents.at(key);
-    };
+        return std::lexicographical_compare(
+          lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+              return ascii_lower(a) < ascii_lower(b);
+          });
+    }
 
-    /// @brief Get as type T
-    /// @throws INIException if conversion to type T fails.
-    /// @throws std::out_of_range if key doesn't exist.
-    template<typename T>
-    T get_as(const std::string& key)
+    /// @brief Returns true if @name starts with @prefix
+    bool is_prefix(std::string_view prefix, std::string_view name) const
     {
-        auto val = get(key);
-        std::stringstream ss(val);
-        T retval;
-        ss >> retval;
-        if (ss.fail()) {
-            throw INIException("Conversion failed from value '" + val + "'");
+        if (!case_insensitive) {
+            return name.starts_with(prefix);
         }
-        return retval;
+        return name.size() >= prefix.size() &&
+               std::equal(prefix.begin(),
+                          prefix.end(),
+                          name.begin(),
+                          [](char a, char b) {
+                              return ascii_lower(a) == ascii_lower(b);
+                          });
     }
+};
 
-    /// @brief Get the stored values as std::map
-    /// @return the key value map for this ini configuration section
-    std::map<std::string, std::string> get_map() { return m_contents; };
+SIMPLEINI_EXPORT using key_map = std::map<std::string, std::string, key_less>;
+
+/// @brief Hash of a name, folding ASCII case like key_less when
+/// case_insensitive is set
+struct name_hash
+{
+    bool case_insensitive = false;
 
-    std::string as_string() const
+    std::size_t operator()(std::string_view name) const
     {
-        std::string config_section;
-        config_section += "[" + m_name + "]\n";
-        for (const auto& content : m_contents) {
-            config_section += content.first + " = " + content.second + "\n";
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(
+                             case_insensitive ? ascii_lower(c) : c)) *
+                   1099511628211ULL;
         }
-        return config_section;
+        return static_cast<std::size_t>(hash);
     }
+};
 
-  private:
-    std::string m_name;
-    std::map<std::string, std::string> m_contents;
+/// @brief Equality of names matching name_hash
+struct name_equal
+{
+    bool case_insensitive = false;
+
+    bool operator()(std::string_view lhs, std::string_view rhs) const
+    {
+        return lhs.size() == rhs.size() &&
+               key_less{ case_insensitive }.is_prefix(lhs, rhs);
+    }
 };
 
-class SimpleINI
+/// @brief Names mapped to values of type T. Sorted tables are a std::map
+/// ordered by key_less. Ordered tables keep insertion order in a deque of
+/// entries and find names through a hash index. Iterators and lookups work
+/// the same for both, so the layout is chosen at run time.
+SIMPLEINI_EXPORT template<typename T>
+class name_table
 {
+    using sorted_map = std::map<std::string, T, key_less>;
+    using entry_list = std::deque<std::pair<const std::string, T>>;
+
   public:
-    SimpleINI(){};
+    using value_type = typename sorted_map::value_type;
 
-    /// @brief Create a SimpleINI object
-    /// @param configfilepath path to the used configuration .ini file.
-    /// @throws INIException if the file at @configfilepath isn't in valid .ini
-    /// format.
-    explicit SimpleINI(std::filesystem::path configfilepath)
-      : m_path(configfilepath)
+    class const_iterator
     {
-        read_content();
-        parse_sections();
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = name_table::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const
+        {
+            return m_ordered ? *m_entry : *m_node;
+        }
+        pointer operator->() const { return &**this; }
+
+        const_iterator& operator++()
+        {
+            if (m_ordered) {
+                ++m_entry;
+            } else {
+                ++m_node;
+            }
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+        const_iterator& operator--()
+        {
+            if (m_ordered) {
+                --m_entry;
+            } else {
+                --m_node;
+            }
+            return *this;
+        }
+        const_iterator operator--(int)
+        {
+            auto copy = *this;
+            --*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return m_ordered ? m_entry == other.m_entry
+                             : m_node == other.m_node;
+        }
+
+      private:
+        friend class name_table;
+
+        explicit const_iterator(typename sorted_map::const_iterator node)
+          : m_node(node){};
+        explicit const_iterator(typename entry_list::const_iterator entry)
+          : m_entry(entry)
+          , m_ordered(true){};
+
+        typename sorted_map::const_iterator m_node;
+        typename entry_list::const_iterator m_entry;
+        bool m_ordered = false;
     };
 
-    ~SimpleINI(){};
+    name_table(){};
 
-    /// @brief Read a configuration file.
-    /// @param path Path to the configuration file.
-    void set_config_file(std::filesystem::path path, bool read_conf = true)
+    /// @brief Empty table comparing names with @less, kept in insertion order
+    /// if @ordered is set
+    explicit name_table(key_less less, bool ordered = false);
+
+    /// @brief Sorted table taking the nodes of @sorted
+    explicit name_table(sorted_map sorted)
+      : m_sorted(std::move(sorted)){};
+
+    name_table(const name_table& other);
+    name_table(name_table&&) = default;
+    name_table& operator=(const name_table& other)
     {
-        m_path = path;
-        if (read_conf) {
-            read_content();
-            parse_sections();
+        if (this != &other) {
+            name_table copy(other);
+            *this = std::move(copy);
         }
-    }
+        return *this;
+    };
+    name_table& operator=(name_table&&) = default;
 
-    /// @brief Get the configuration file path.
-    /// @return std::filesystem::path to the file.
-    std::filesystem::path get_config_path() { return m_path; };
+    /// @brief True if the table keeps insertion order
+    bool ordered() const { return m_ordered != nullptr; };
 
-    /// @brief Return section with key @key
-    /// @param key the key for the section
-    /// @return INISection for key
-    /// @throws std::out_of_range if section doesn't exist
-    INISection operator[](const std::string& key) const
+    key_less key_comp() const { return m_sorted.key_comp(); };
+
+    std::size_t size() const
+    {
+        return m_ordered ? entries().size() : m_sorted.size();
+    };
+
+    [[nodiscard]] bool empty() const { return size() == 0; };
+
+    const_iterator begin() const
+    {
+        return m_ordered ? const_iterator(entries().cbegin())
+                         : const_iterator(m_sorted.begin());
+    };
+    const_iterator end() const
+    {
+        return m_ordered ? const_iterator(entries().cend())
+                         : const_iterator(m_sorted.end());
+    };
+
+    /// @brief Find the value of @name
+    /// @return pointer to the value, or nullptr if the name doesn't exist
+    const T* find(std::string_view name) const
     {
-        if (!m_sections.contains(key)) {
-            throw std::out_of_range("No section '" + key + "'");
+        if (m_ordered) {
+            return find_ordered(name);
         }
-        return m_sections.at(key);
+        auto it = m_sorted.find(name);
+        return it == m_sorted.end() ? nullptr : &it->second;
+    };
+    T* find(std::string_view name)
+    {
+        return const_cast<T*>(std::as_const(*this).find(name));
     };
 
-    /// @brief Get the section name - INISection map
-    /// @return the stored std::map
-    std::map<std::string, INISection> get_map() const { return m_sections; };
+    /// @brief First entry whose name doesn't sort before @name. Ordered
+    /// tables search linearly and iteration continues in insertion order.
+    const_iterator lower_bound(std::string_view name) const;
 
-    /// @brief Write all configuration data to m_path.
-    void write() const
+    /// @brief Add @name with a value constructed from @args unless it exists
+    /// @return the value of @name and true if it was added
+    template<typename... Args>
+    std::pair<T*, bool> try_emplace(std::string name, Args&&... args)
     {
-        std::string config;
-        for (const auto& section : m_sections) {
-            config += section.second.as_string();
+        if (!m_ordered) {
+            auto [it, added] = m_sorted.try_emplace(
+              std::move(name), std::forward<Args>(args)...);
+            return { &it->second, added };
+        }
+        if (T* found = find(name)) {
+            return { found, false };
         }
-        std::ofstream config_of(m_path);
-        config_of << config;
-        config_of.close();
+        auto& entry = entries().emplace_back(
+          std::piecewise_construct,
+          std::forward_as_tuple(std::move(name)),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+        index_last();
+        return { &entry.second, true };
     }
 
-    /// @brief Add INI section
-    /// @param name section header
-    /// @param section INISection
-    void add_section(const std::string& name, const INISection& section)
+    /// @brief Set the value of @name, adding it if it doesn't exist
+    template<typename V>
+    void insert_or_assign(std::string name, V&& value)
+    {
+        if (T* found = find(name)) {
+            *found = std::forward<V>(value);
+        } else {
+            try_emplace(std::move(name), std::forward<V>(value));
+        }
+    }
+
+    /// @brief Call @visit(name, value) for every entry in iteration order,
+    /// with the value modifiable
+    template<typename Visit>
+    void for_each(Visit&& visit)
     {
-        m_sections[name] = section;
+        if (m_ordered) {
+            for (auto& [name, value] : entries()) {
+                visit(name, value);
+            }
+        } else {
+            for (auto& [name, value] : m_sorted) {
+                visit(name, value);
+            }
+        }
     }
 
+    void clear();
+
+    /// @brief Move the entries out into a std::map, leaving the table empty
+    std::map<std::string, T> take();
+
   private:
-    std::filesystem::path m_path;
-    std::vector<std::string> m_content;
-    std::map<std::string, INISection> m_sections;
+    // Insertion order layout, allocated only for ordered tables so sorted
+    // ones, like most section bodies, stay a bare std::map. Its hash index is
+    // defined with the implementation.
+    struct ordered_entries;
+    struct ordered_delete
+    {
+        void operator()(ordered_entries* ordered) const;
+    };
+
+    entry_list& entries() const;
+    const T* find_ordered(std::string_view name) const;
+    /// Add the entry appended last to the index
+    void index_last();
+
+    sorted_map m_sorted;
+    std::unique_ptr<ordered_entries, ordered_delete> m_ordered;
+};
+
+/// @brief Limits protecting the parser against pathological input. Parsing
+/// stops with an INIException as soon as a limit is exceeded.
+SIMPLEINI_EXPORT struct INILimits
+{
+    static constexpr std::size_t unlimited =
+      std::numeric_limits<std::size_t>::max();
+
+    /// Maximum size of the input in bytes, newlines included.
+    std::size_t max_file_size = unlimited;
+
+    /// Maximum length of a line in bytes. Longer lines are never buffered in
+    /// full when reading from a stream.
+    std::size_t max_line_length = unlimited;
+
+    /// Maximum number of section headers.
+    std::size_t max_sections = unlimited;
+
+    /// Maximum number of key value lines in a single section.
+    std::size_t max_keys_per_section = unlimited;
+
+    /// Maximum combined size of all section names, keys and values in bytes.
+    std::size_t max_total_bytes = unlimited;
+};
+
+/// @brief Read the whole file at @path, failing as soon as it exceeds
+/// limits.max_file_size. Regular files are read at once into an exactly
+/// sized buffer, pipes and files whose size isn't known up front, like those
+/// in /proc, are read in chunks until their end.
+/// @throws INIException if the file doesn't exist, can't be read or is too
+/// large
+SIMPLEINI_EXPORT std::string
+read_file(const std::filesystem::path& path, const INILimits& limits);
+
+/// @brief Optional syntax understood by the parser. Both extensions are off
+/// by default so existing values keep their text.
+SIMPLEINI_EXPORT struct INISyntax
+{
+    /// Strip comments starting with ';' or '#' after a value. The comment
+    /// character must follow a blank, so "a#b" keeps its '#'.
+    bool inline_comments = false;
+
+    /// Unquote values enclosed in single or double quotes. Double quoted
+    /// values may use the escapes \\ \" \' \n \t \r \0 \; and \#.
+    bool quoted_values = false;
 
-    void read_content()
+    /// Continue a value ending in a backslash on the next line. The backslash
+    /// and the indentation of the next line are removed. Inline comments and
+    /// quotes are read on each line, so a comment before the backslash ends
+    /// only that line.
+    bool backslash_continuation = false;
+
+    /// Continue a value on the following indented lines, joined with
+    /// newlines after removing the indentation. Indented lines starting with
+    /// ';' or '#' are comments and skipped, as in Python's configparser.
+    bool indented_continuation = false;
+};
+
+SIMPLEINI_EXPORT class INISectionStore;
+
+/// @brief Options controlling how configuration files are loaded.
+SIMPLEINI_EXPORT struct INIOptions
+{
+    /// Match section and key names ignoring ASCII case.
+    bool case_insensitive = false;
+
+    /// Sections to load. Entries ending in '*' match by prefix. An empty list
+    /// loads every section.
+    std::vector<std::string> sections;
+
+    /// Limits enforced while parsing.
+    INILimits limits;
+
+    /// Syntax extensions enabled while parsing.
+    INISyntax syntax;
+
+    /// Decode integer, floating point and boolean values while loading, in
+    /// parallel for large files, so get_as<T> reads integers and doubles
+    /// without parsing.
+    bool decode_types = false;
+
+    /// Keep sections and keys in the order they were read or added, for
+    /// iteration and write(), instead of sorting them by name.
+    bool preserve_order = false;
+
+    /// Share the contents of sections with identical sections of other
+    /// configurations loaded with the same store.
+    std::shared_ptr<INISectionStore> section_store;
+
+    /// @brief Returns true if section @name passes the section allowlist,
+    /// matching names like case_insensitive does.
+    bool wants_section(std::string_view name) const
     {
-        if (!std::filesystem::exists(m_path)) {
-            throw INIException("File not found:" + m_path.string());
+        if (sections.empty()) {
+            return true;
         }
+        const key_less fold{ case_insensitive };
+        for (std::string_view pattern : sections) {
+            if (pattern.ends_with('*')) {
+                pattern.remove_suffix(1);
+            } else if (name.size() != pattern.size()) {
+                continue;
+            }
+            if (fold.is_prefix(pattern, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/// std::from_chars for floating point numbers, with the rules of
+/// operator>>: "inf", "infinity" and "nan" aren't numbers, and a number too
+/// small for T reads as zero of its sign instead of failing. Numbers too
+/// large for T still fail with std::errc::result_out_of_range. Falls back to
+/// from_chars_strtold where the standard library has no std::from_chars for
+/// T.
+template<typename T>
+std::from_chars_result
+from_chars_floating(const char* first, const char* last, T& value);
+
+/// std::from_chars for standard libraries that lack it for T, like libc++
+/// for long double. Scans the number std::from_chars would and converts it
+/// with strtold, which follows the decimal point of the C locale and rounds
+/// twice for types narrower than long double. Numbers too small for T read
+/// as zero of their sign.
+template<typename T>
+std::from_chars_result
+from_chars_strtold(const char* first, const char* last, T& value);
+
+/// @brief Parse the floating point number at the start of @str like
+/// operator>> would, but locale independent and correctly rounded. Uses
+/// std::from_chars, which implements the Eisel-Lemire algorithm with an exact
+/// fallback in current standard libraries. Like operator>>, inf and nan
+/// aren't accepted, and numbers too small for T read as zero.
+/// @return false if @str doesn't start with a number or it is too large
+SIMPLEINI_EXPORT template<typename T>
+bool
+parse_floating(std::string_view str, T& value);
+
+/// @brief Typed representation of a decoded value
+SIMPLEINI_EXPORT using INIValue = std::variant<long long, double, bool>;
+
+/// @brief Decode @str as a boolean (true/false, yes/no, on/off in any case),
+/// an integer or a floating point number. The whole string has to match.
+/// @return the decoded value, or nothing if @str is plain text
+SIMPLEINI_EXPORT std::optional<INIValue>
+decode_value(std::string_view str);
+
+/// @brief Scan a duration such as "250ms", "1.5 h" or "1h 30m" in ns, us, ms,
+/// s, m/min, h or d into @duration without allocating.
+/// @return nullptr on success, otherwise the reason the value is invalid
+SIMPLEINI_EXPORT const char*
+scan_duration(std::string_view str, std::chrono::nanoseconds& duration);
 
-        m_content.clear();
-        std::ifstream configstream(m_path);
+/// @brief Scan a size such as "4KiB" or "1.5 GB" into @bytes without
+/// allocating. KB, MB, GB, TB and PB are powers of 1000; KiB, MiB, GiB, TiB,
+/// PiB and the single letters K, M, G, T and P are powers of 1024.
+/// @return nullptr on success, otherwise the reason the value is invalid
+SIMPLEINI_EXPORT const char*
+scan_bytes(std::string_view str, std::uint64_t& bytes);
 
-        std::string line;
-        while (std::getline(configstream, line)) {
-            if (string_is_valid(line)) {
-                m_content.push_back(line);
+/// @brief Scan a percentage such as "75%" or "12.5 %" into @ratio, 75% being
+/// 0.75, without allocating.
+/// @return nullptr on success, otherwise the reason the value is invalid
+SIMPLEINI_EXPORT const char*
+scan_percent(std::string_view str, double& ratio);
+
+/// @brief Read @value into @out with operator>> of a std::istringstream.
+/// Defined with the implementation, for the arithmetic types and std::string.
+/// @return false if the extraction failed
+template<typename T>
+bool
+stream_value(const std::string& value, T& out);
+
+/// @brief Read @value by calling @read with a std::istringstream over it and
+/// @out, for types that define their own operator>>.
+/// @return false if the extraction failed
+SIMPLEINI_EXPORT bool
+stream_value(const std::string& value,
+             void* out,
+             void (*read)(std::istream& input, void* out));
+
+/// @brief Names of the values of enum @E, read by INISection::get_as<E>().
+/// Specialize it with a constexpr array of name and value pairs:
+///
+///     template<>
+///     struct simpleini::enum_names<Level>
+///     {
+///         static constexpr std::pair<std::string_view, Level> names[] = {
+///             { "debug", Level::debug }, { "info", Level::info }
+///         };
+///     };
+///
+/// The lookup table is defined in simpleini_enum.h, which this header only
+/// includes without SIMPLEINI_COMPILED.
+SIMPLEINI_EXPORT template<typename E>
+struct enum_names;
+
+SIMPLEINI_EXPORT template<typename E>
+class enum_table;
+
+/// @brief Convert @value of @key in section @section to type T, the way
+/// INISection::get_as() reads values without a decoded type. Enums are read
+/// by name, see enum_names.
+/// @throws INIException if conversion to type T fails.
+template<typename T>
+T
+value_as(std::string_view section,
+         std::string_view key,
+         const std::string& value)
+{
+    if constexpr (std::is_enum_v<T>) {
+        static_assert(requires { enum_table<T>::find(value); },
+                      "include simpleini_enum.h to read enums");
+        if (const T* found = enum_table<T>::find(value)) {
+            return *found;
+        }
+        throw INIException("Invalid value '" + value + "' for key '" +
+                           std::string(key) + "' in section '" +
+                           std::string(section) + "': expected one of " +
+                           enum_table<T>::valid_names());
+    } else {
+        T retval;
+        if constexpr (std::is_floating_point_v<T>) {
+            if (!parse_floating(value, retval)) {
+                throw INIException("Conversion failed from value '" + value +
+                                   "'");
             }
+        } else {
+            bool read = false;
+            if constexpr (std::is_arithmetic_v<T> ||
+                          std::is_same_v<T, std::string>) {
+                read = stream_value(value, retval);
+            } else {
+                read = stream_value(
+                  value, &retval, [](std::istream& input, void* out) {
+                      input >> *static_cast<T*>(out);
+                  });
+            }
+            if (!read) {
+                throw INIException("Conversion failed from value '" + value +
+                                   "'");
+            }
+        }
+        return retval;
+    }
+}
+
+SIMPLEINI_EXPORT class INISection
+{
+  public:
+    INISection(){};
+
+    explicit INISection(std::string name)
+      : m_name(std::move(name)){};
+
+    /// Copies are deep, except that contents interned in an INISectionStore
+    /// stay shared until modified.
+    INISection(const INISection& other)
+      : m_name(other.m_name)
+      , m_body(other.copy_body()){};
+    INISection(INISection&&) = default;
+    INISection& operator=(const INISection& other)
+    {
+        if (this != &other) {
+            m_name = other.m_name;
+            m_body = other.copy_body();
+        }
+        return *this;
+    };
+    INISection& operator=(INISection&&) = default;
+
+    /// @brief Create a section from a key value map
+    /// @param name section header
+    /// @param content key value pairs, moved from when passed as an rvalue
+    explicit INISection(std::string name,
+                        std::map<std::string, std::string> content);
+
+    /// @brief Create a section using the name matching of @options
+    /// @param name section header
+    /// @param content key value pairs, moved from when passed as an rvalue
+    /// @param options load options, only name matching and ordering are used
+    explicit INISection(std::string name,
+                        key_map content,
+                        const INIOptions& options);
+
+    using const_iterator = name_table<std::string>::const_iterator;
+
+    /// @brief Returns true if the INISection is empty
+    /// @return boolean
+    [[nodiscard]] bool empty() const { return contents().empty(); };
+
+    /// @brief Number of key value pairs in the section
+    std::size_t size() const { return contents().size(); };
+
+    /// @brief Name of the section
+    const std::string& name() const { return m_name; };
+
+    /// @brief Return value of key @key
+    /// @param key the key for the value
+    /// @return string value of key
+    /// @throws std::out_of_range if key doesn't exist
+    const std::string& operator[](std::string_view key) const
+    {
+        return get(key);
+    };
+
+    /// @brief Return value of key @key
+    /// @param key the key for the value
+    /// @return string value of key
+    /// @throws std::out_of_range if key doesn't exist
+    const std::string& get(std::string_view key) const
+    {
+        const auto* value = contents().find(key);
+        if (!value) {
+            throw std::out_of_range("No key '" + std::string(key) +
+                                    "' in section '" + m_name + "'");
         }
+        return *value;
     };
 
-    void parse_sections()
+    /// @brief Find the value of key @key
+    /// @return pointer to the value, or nullptr if the key doesn't exist
+    const std::string* find(std::string_view key) const
     {
-        m_sections.clear();
-        std::map<std::string, std::string> config_items;
-        std::string current_section;
+        return contents().find(key);
+    };
 
-        for (const auto& line : m_content) {
-            if (line.starts_with('[')) {
-                if (!current_section.empty()) {
-                    m_sections.insert(
-                      { current_section,
-                        INISection{ current_section, config_items } });
-                    config_items.clear();
+    /// @brief Iterate the key value pairs without copying them
+    const_iterator begin() const { return contents().begin(); };
+    const_iterator end() const { return contents().end(); };
+
+    /// @brief View over the keys of the section
+    auto keys() const { return std::views::keys(contents()); };
+
+    /// @brief View over the values of the section
+    auto values() const { return std::views::values(contents()); };
+
+    /// @brief Get as type T. Enums are read by name, see enum_names.
+    /// @throws INIException if conversion to type T fails.
+    /// @throws std::out_of_range if key doesn't exist.
+    template<typename T>
+    T get_as(std::string_view key) const
+    {
+        if constexpr (reads_typed<T>) {
+            if (const auto* typed = get_typed(key)) {
+                if (auto value = typed_as<T>(*typed)) {
+                    return *value;
                 }
-                current_section = parse_section_value(line);
-            } else if (line.find('=') != line.npos) {
-                auto configs = parse_key_value(line);
-                config_items.insert(configs);
-            } else {
-                throw INIException{ "Failure when parsing line " + line };
             }
         }
-        if (!current_section.empty()) {
-            m_sections.insert(
-              { current_section, INISection{ current_section, config_items } });
-            config_items.clear();
+        return value_as<T>(m_name, key, get(key));
+    }
+
+    /// @brief Get value of @key as a duration, e.g. "250ms" or "1h 30m".
+    /// See scan_duration().
+    /// @throws INIException if the value isn't a valid duration.
+    /// @throws std::out_of_range if key doesn't exist.
+    template<typename Duration = std::chrono::milliseconds>
+    Duration get_duration(std::string_view key) const
+    {
+        const auto& val = get(key);
+        std::chrono::nanoseconds duration;
+        if (const char* error = scan_duration(val, duration)) {
+            invalid_value("duration", key, val, error);
+        }
+        return std::chrono::duration_cast<Duration>(duration);
+    }
+
+    /// @brief Get value of @key as a byte count, e.g. "4KiB" or "10 MB".
+    /// See scan_bytes().
+    /// @throws INIException if the value isn't a valid size.
+    /// @throws std::out_of_range if key doesn't exist.
+    std::uint64_t get_bytes(std::string_view key) const
+    {
+        const auto& val = get(key);
+        std::uint64_t bytes = 0;
+        if (const char* error = scan_bytes(val, bytes)) {
+            invalid_value("size", key, val, error);
         }
+        return bytes;
     };
-};
-}
+
+    /// @brief Get value of @key as a fraction, "75%" being 0.75.
+    /// @throws INIException if the value isn't a valid percentage.
+    /// @throws std::out_of_range if key doesn't exist.
+    double get_percent(std::string_view key) const
+    {
+        const auto& val = get(key);
+        double ratio = 0;
+        if (const char* error = scan_percent(val, ratio)) {
+            invalid_value("percentage", key, val, error);
+        }
+        return ratio;
+    };
+
+    /// @brief Get value of @key as a boolean: true/false, yes/no, on/off in
+    /// any case, or 1/0.
+    /// @throws INIException if the value isn't a valid boolean.
+    /// @throws std::out_of_range if key doesn't exist.
+    bool get_bool(std::string_view key) const;
+
+    /// @brief Set the value of key @key, replacing an existing value
+    /// @param key the key for the value
+    /// @param value the new value
+    void set(std::string key, std::string value);
+
+    /// @brief Decode every value with decode_value() and store the typed
+    /// representations next to the text.
+    void decode();
+
+    /// @brief Get the typed representation of the value of @key
+    /// @return pointer to the value, or nullptr if the key doesn't exist or
+    /// wasn't decoded by decode()
+    const INIValue* get_typed(std::string_view key) const
+    {
+        if (!m_body) {
+            return nullptr;
+        }
+        auto it = m_body->typed.find(key);
+        return it == m_body->typed.end() ? nullptr : &it->second;
+    };
+
+    /// @brief Add key @key unless it already exists
+    /// @param key the key for the value
+    /// @param value the value
+    /// @return true if the key was added
+    bool emplace(std::string key, std::string value);
+
+    /// @brief Get the stored values as std::map
+    /// @return the key value map for this ini configuration section
+    std::map<std::string, std::string> get_map() const;
+
+    /// @brief Move the stored values out of the section, leaving it empty
+    /// @return the key value map for this ini configuration section
+    std::map<std::string, std::string> take_map();
+
+    /// @brief Format the section in .ini format
+    std::string as_string() const;
+
+  private:
+    friend class INISectionStore;
+
+    struct body
+    {
+        name_table<std::string> contents;
+        std::map<std::string, INIValue, key_less> typed;
+        // Set once the body is published in an INISectionStore
+        bool interned = false;
+    };
+
+    std::string m_name;
+    std::shared_ptr<body> m_body;
+
+    const name_table<std::string>& contents() const
+    {
+        static const name_table<std::string> empty;
+        return m_body ? m_body->contents : empty;
+    }
+
+    // Only interned bodies are ever shared. They are immutable, so sharing
+    // them needs no synchronization beyond the store's lock.
+    std::shared_ptr<body> copy_body() const;
+
+    /// The body, copied first if it's interned and so shared
+    body& mutable_body();
+
+    [[noreturn]] void invalid_value(const char* type,
+                                    std::string_view key,
+                                    const std::string& value,
+                                    const char* reason) const
+    {
+        throw INIException("Invalid " + std::string(type) + " '" + value +
+                           "' for key '" + std::string(key) +
+                           "' in section '" + m_name + "': " + reason);
+    }
+
+    /// Types get_as reads from the typed cache: the standard integer types
+    /// and double. float and long double parse the text, converting the
+    /// cached double would round twice. bool and character types keep the
+    /// stream conversion.
+    template<typename T>
+    static constexpr bool reads_typed =
+      std::is_same_v<T, double> ||
+      (std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+       !std::is_same_v<T, char> && !std::is_same_v<T, signed char> &&
+       !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t> &&
+       !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+       !std::is_same_v<T, char32_t>);
+
+    /// Convert a decoded value to T if it fits without loss of range.
+    /// Otherwise get_as falls back to parsing the text, which reports the
+    /// error.
+    template<typename T>
+    static std::optional<T> typed_as(const INIValue& typed)
+    {
+        static_assert(reads_typed<T>);
+        if (const auto* integer = std::get_if<long long>(&typed)) {
+            if constexpr (std::is_floating_point_v<T>) {
+                return static_cast<T>(*integer);
+            } else if (std::in_range<T>(*integer)) {
+                return static_cast<T>(*integer);
+            }
+        } else if (const auto* floating = std::get_if<double>(&typed)) {
+            if constexpr (std::is_floating_point_v<T>) {
+                return *floating;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+SIMPLEINI_EXPORT class SimpleINI
+{
+  public:
+    SimpleINI(){};
+
+    /// @brief Create an empty SimpleINI matching names and ordering entries
+    /// as @options says, for building a configuration in memory
+    explicit SimpleINI(INIOptions options)
+      : m_options(std::move(options)){};
+
+    /// @brief Create a SimpleINI object
+    /// @param configfilepath path to the used configuration .ini file.
+    /// @throws INIException if the file at @configfilepath isn't in valid .ini
+    /// format.
+    explicit SimpleINI(std::filesystem::path configfilepath)
+      : m_path(configfilepath)
+    {
+        read_content();
+    };
+
+    /// @brief Create a SimpleINI object
+    /// @param configfilepath path to the used configuration .ini file.
+    /// @param options options used when reading the file.
+    /// @throws INIException if the file at @configfilepath isn't in valid .ini
+    /// format.
+    explicit SimpleINI(std::filesystem::path configfilepath, INIOptions options)
+      : m_path(configfilepath)
+      , m_options(std::move(options))
+    {
+        read_content();
+    };
+
+    /// @brief Read a configuration file.
+    /// @param path Path to the configuration file.
+    void set_config_file(std::filesystem::path path, bool read_conf = true)
+    {
+        m_path = path;
+        if (read_conf) {
+            read_content();
+        }
+    }
+
+    /// @brief Get the configuration file path.
+    /// @return std::filesystem::path to the file.
+    std::filesystem::path get_config_path() { return m_path; };
+
+    /// @brief Get the options used when reading the configuration file.
+    const INIOptions& get_options() const { return m_options; };
+
+    /// @brief Return section with key @key
+    /// @param key the key for the section
+    /// @return INISection for key
+    /// @throws std::out_of_range if section doesn't exist
+    const INISection& operator[](std::string_view key) const
+    {
+        const auto* section = m_sections.find(key);
+        if (!section) {
+            throw std::out_of_range("No section '" + std::string(key) + "'");
+        }
+        return *section;
+    };
+
+    /// @brief Get the section name - INISection map
+    /// @return the stored std::map
+    std::map<std::string, INISection> get_map() const;
+
+    using const_iterator = name_table<INISection>::const_iterator;
+
+    /// @brief Iterate the sections without copying them
+    const_iterator begin() const { return m_sections.begin(); };
+    const_iterator end() const { return m_sections.end(); };
+
+    /// @brief Find section @key
+    /// @return pointer to the section, or nullptr if it doesn't exist
+    const INISection* find(std::string_view key) const
+    {
+        return m_sections.find(key);
+    };
+
+    /// @brief First section whose name doesn't sort before @key. With
+    /// INIOptions::preserve_order the sections after it aren't sorted.
+    const_iterator lower_bound(std::string_view key) const
+    {
+        return m_sections.lower_bound(key);
+    };
+
+    /// @brief Number of sections
+    std::size_t size() const { return m_sections.size(); };
+
+    /// @brief View over the section names
+    auto section_names() const { return std::views::keys(m_sections); };
+
+    /// @brief View over the sections
+    auto sections() const { return std::views::values(m_sections); };
+
+    /// @brief Write all configuration data to m_path.
+    void write() const;
+
+    /// @brief Add INI section
+    /// @param name section header
+    /// @param section INISection
+    void add_section(const std::string& name, const INISection& section);
+
+    /// @brief Add INI section without copying it
+    /// @param name section header
+    /// @param section INISection
+    void add_section(const std::string& name, INISection&& section);
+
+    /// @brief Get section @name for modification, creating it if needed.
+    /// Allows building sections in place without intermediate copies.
+    /// @param name section header
+    /// @return reference to the stored INISection
+    INISection& emplace_section(const std::string& name);
+
+    /// @brief Set the value of @key in section @section, creating the
+    /// section if needed.
+    void set(const std::string& section, std::string key, std::string value);
+
+  private:
+    std::filesystem::path m_path;
+    INIOptions m_options;
+    name_table<INISection> m_sections{ key_less{ m_options.case_insensitive },
+                                       m_options.preserve_order };
+
+    /// Visitor collecting parsed lines into INISections.
+    struct section_builder;
+
+    void read_content();
+    void decode_sections();
+};
+
+/// @brief Walk two ranges sorted by @less in step, calling @left or @right for
+/// elements only in one of them and @both for elements in both.
+template<typename Range,
+         typename Less,
+         typename Left,
+         typename Right,
+         typename Both>
+void
+merge_walk(const Range& lhs,
+           const Range& rhs,
+           Less less,
+           Left&& left,
+           Right&& right,
+           Both&& both)
+{
+    auto lit = lhs.begin();
+    auto rit = rhs.begin();
+    while (lit != lhs.end() || rit != rhs.end()) {
+        if (rit == rhs.end() ||
+            (lit != lhs.end() && less(lit->first, rit->first))) {
+            left(*lit++);
+        } else if (lit == lhs.end() || less(rit->first, lit->first)) {
+            right(*rit++);
+        } else {
+            both(*lit++, *rit++);
+        }
+    }
+}
+
+/// @brief Like merge_walk for ranges that aren't sorted, matching elements by
+/// looking their names up with find().
+template<typename Range, typename Left, typename Right, typename Both>
+void
+lookup_walk(const Range& lhs,
+            const Range& rhs,
+            Left&& left,
+            Right&& right,
+            Both&& both)
+{
+    for (const auto& item : lhs) {
+        if (const auto* found = rhs.find(item.first)) {
+            using mapped = std::remove_pointer_t<decltype(found)>;
+            both(item,
+                 std::pair<const std::string&, mapped&>(item.first, *found));
+        } else {
+            left(item);
+        }
+    }
+    for (const auto& item : rhs) {
+        if (!lhs.find(item.first)) {
+            right(item);
+        }
+    }
+}
+
+/// @brief Report every key whose value differs between @before and @after as
+/// on_change(section, key, old_value, new_value). A value missing on one side
+/// is passed as nullptr. Runs in linear time over both configurations.
+SIMPLEINI_EXPORT template<typename Callback>
+void
+diff(const SimpleINI& before, const SimpleINI& after, Callback&& on_change)
+{
+    const key_less less{ before.get_options().case_insensitive };
+    auto removed = [&](const auto& section) {
+        for (const auto& [key, value] : section.second) {
+            on_change(section.first, key, &value, nullptr);
+        }
+    };
+    auto added = [&](const auto& section) {
+        for (const auto& [key, value] : section.second) {
+            on_change(section.first, key, nullptr, &value);
+        }
+    };
+    // Configurations kept in source order are matched by lookup instead
+    const bool sorted = !before.get_options().preserve_order &&
+                        !after.get_options().preserve_order;
+    auto walk = [&](const auto& lhs,
+                    const auto& rhs,
+                    auto&& left,
+                    auto&& right,
+                    auto&& both) {
+        if (sorted) {
+            merge_walk(lhs, rhs, less, left, right, both);
+        } else {
+            lookup_walk(lhs, rhs, left, right, both);
+        }
+    };
+    auto changed = [&](const auto& old_section, const auto& new_section) {
+        std::string_view name = new_section.first;
+        walk(
+          old_section.second,
+          new_section.second,
+          [&](const auto& item) {
+              on_change(name, item.first, &item.second, nullptr);
+          },
+          [&](const auto& item) {
+              on_change(name, item.first, nullptr, &item.second);
+          },
+          [&](const auto& old_item, const auto& new_item) {
+              if (old_item.second != new_item.second) {
+                  on_change(
+                    name, new_item.first, &old_item.second, &new_item.second);
+              }
+          });
+    };
+    walk(before, after, removed, added, changed);
+}
+
+}
+
+#if !defined(SIMPLEINI_COMPILED) || defined(SIMPLEINI_IMPLEMENTATION)
+#include "simpleini_enum.h"
+#include "simpleini_parser.h"
+#include "simpleini_store.h"
+
+namespace simpleini {
+template<typename T>
+struct name_table<T>::ordered_entries
+{
+    explicit ordered_entries(key_less less)
+      : index(0,
+              name_hash{ less.case_insensitive },
+              name_equal{ less.case_insensitive }){};
+
+    // The index refers to the names stored in the entries, so copies
+    // rebuild it
+    ordered_entries(const ordered_entries& other)
+      : entries(other.entries)
+      , index(other.index.size(),
+              other.index.hash_function(),
+              other.index.key_eq())
+    {
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            index.emplace(entries[i].first, i);
+        }
+    };
+
+    entry_list entries;
+    std::unordered_map<std::string_view, std::size_t, name_hash, name_equal>
+      index;
+};
+
+template<typename T>
+name_table<T>::name_table(key_less less, bool ordered)
+  : m_sorted(less)
+{
+    if (ordered) {
+        m_ordered.reset(new ordered_entries(less));
+    }
+}
+
+template<typename T>
+name_table<T>::name_table(const name_table& other)
+  : m_sorted(other.m_sorted)
+{
+    if (other.m_ordered) {
+        m_ordered.reset(new ordered_entries(*other.m_ordered));
+    }
+}
+
+template<typename T>
+void
+name_table<T>::ordered_delete::operator()(ordered_entries* ordered) const
+{
+    delete ordered;
+}
+
+template<typename T>
+typename name_table<T>::const_iterator
+name_table<T>::lower_bound(std::string_view name) const
+{
+    if (!m_ordered) {
+        return const_iterator(m_sorted.lower_bound(name));
+    }
+    const key_less less = key_comp();
+    const auto& ordered = m_ordered->entries;
+    return const_iterator(
+      std::find_if(ordered.begin(), ordered.end(), [&](const auto& e) {
+          return !less(e.first, name);
+      }));
+}
+
+template<typename T>
+void
+name_table<T>::clear()
+{
+    m_sorted.clear();
+    if (m_ordered) {
+        m_ordered->entries.clear();
+        m_ordered->index.clear();
+    }
+}
+
+template<typename T>
+std::map<std::string, T>
+name_table<T>::take()
+{
+    std::map<std::string, T> taken;
+    if (m_ordered) {
+        for (auto& entry : m_ordered->entries) {
+            taken.try_emplace(entry.first, std::move(entry.second));
+        }
+        clear();
+    } else {
+        taken.merge(m_sorted);
+        m_sorted.clear();
+    }
+    return taken;
+}
+
+template<typename T>
+typename name_table<T>::entry_list&
+name_table<T>::entries() const
+{
+    return m_ordered->entries;
+}
+
+template<typename T>
+const T*
+name_table<T>::find_ordered(std::string_view name) const
+{
+    auto it = m_ordered->index.find(name);
+    return it == m_ordered->index.end()
+             ? nullptr
+             : &m_ordered->entries[it->second].second;
+}
+
+template<typename T>
+void
+name_table<T>::index_last()
+{
+    auto& entries = m_ordered->entries;
+    m_ordered->index.emplace(entries.back().first, entries.size() - 1);
+}
+
+/// Whether the number @str, without its sign and out of range of a
+/// floating point type, is too small rather than too large for it
+SIMPLEINI_INLINE bool
+underflows(std::string_view str)
+{
+    std::size_t exponent_start = str.find_first_of("eE");
+    std::string_view mantissa = str.substr(0, exponent_start);
+    std::size_t point = std::min(mantissa.find('.'), mantissa.size());
+    std::size_t first = mantissa.find_first_not_of("0.");
+    if (first == mantissa.npos) {
+        return true;
+    }
+    // Decimal exponent of the first significant digit
+    long long magnitude = first < point
+                            ? static_cast<long long>(point - first - 1)
+                            : -static_cast<long long>(first - point);
+    if (exponent_start == str.npos) {
+        return magnitude < 0;
+    }
+    std::string_view exponent = str.substr(exponent_start + 1);
+    if (exponent.starts_with('+')) {
+        exponent.remove_prefix(1);
+    }
+    long long power = 0;
+    const char* last = exponent.data() + exponent.size();
+    if (std::from_chars(exponent.data(), last, power).ec != std::errc()) {
+        // Too many digits for long long, only the sign matters
+        return exponent.starts_with('-');
+    }
+    return power < -magnitude;
+}
+
+template<typename T>
+std::from_chars_result
+from_chars_strtold(const char* first, const char* last, T& value)
+{
+    const char* end = first != last && *first == '-' ? first + 1 : first;
+    auto digits = [&end, last] {
+        const char* start = end;
+        while (end != last && *end >= '0' && *end <= '9') {
+            ++end;
+        }
+        return end != start;
+    };
+    bool integer = digits();
+    bool fraction = false;
+    if (end != last && *end == '.') {
+        ++end;
+        fraction = digits();
+    }
+    if (!integer && !fraction) {
+        return { first, std::errc::invalid_argument };
+    }
+    if (end != last && (*end == 'e' || *end == 'E')) {
+        const char* mantissa_end = end++;
+        if (end != last && (*end == '+' || *end == '-')) {
+            ++end;
+        }
+        if (!digits()) {
+            end = mantissa_end;
+        }
+    }
+
+    const std::string number(first, end);
+    const long double parsed = std::strtold(number.c_str(), nullptr);
+    if (std::fabs(parsed) > std::numeric_limits<T>::max()) {
+        return { end, std::errc::result_out_of_range };
+    }
+    value = static_cast<T>(parsed);
+    return { end, std::errc() };
+}
+
+template<typename T>
+std::from_chars_result
+from_chars_floating(const char* first, const char* last, T& value)
+{
+    const char* digits = first != last && *first == '-' ? first + 1 : first;
+    if (digits == last ||
+        (*digits != '.' && (*digits < '0' || *digits > '9'))) {
+        return { first, std::errc::invalid_argument };
+    }
+    if constexpr (!requires { std::from_chars(first, last, value); }) {
+        return from_chars_strtold(first, last, value);
+    } else {
+        auto result = std::from_chars(first, last, value);
+        if (result.ec == std::errc::result_out_of_range &&
+            underflows(std::string_view(digits, result.ptr))) {
+            value = digits == first ? T(0) : -T(0);
+            result.ec = std::errc();
+        }
+        return result;
+    }
+}
+
+template<typename T>
+bool
+parse_floating(std::string_view str, T& value)
+{
+    static_assert(std::is_floating_point_v<T>);
+    str = strip_leading(str);
+    if (str.starts_with('+') && str.size() > 1 && str[1] != '-') {
+        str.remove_prefix(1);
+    }
+    const char* last = str.data() + str.size();
+    return from_chars_floating(str.data(), last, value).ec == std::errc();
+}
+
+SIMPLEINI_INLINE std::optional<INIValue>
+decode_value(std::string_view str)
+{
+    if (str.empty()) {
+        return std::nullopt;
+    }
+    const char* first = str.data();
+    const char* last = first + str.size();
+    long long integer = 0;
+    if (auto [end, ec] = std::from_chars(first, last, integer);
+        ec == std::errc() && end == last) {
+        return integer;
+    }
+    double number = 0;
+    if (auto [end, ec] = from_chars_floating(first, last, number);
+        ec == std::errc() && end == last) {
+        return number;
+    }
+
+    const key_less fold{ true };
+    auto is = [&](std::string_view word) {
+        return str.size() == word.size() && fold.is_prefix(word, str);
+    };
+    if (is("true") || is("yes") || is("on")) {
+        return true;
+    }
+    if (is("false") || is("no") || is("off")) {
+        return false;
+    }
+    return std::nullopt;
+}
+
+/// Number at the start of a value with a unit. Integers are kept exact.
+struct scanned_number
+{
+    long long integer = 0;
+    double decimal = 0;
+    bool is_integer = true;
+};
+
+/// Scan the number at the start of @str and remove it from @str.
+SIMPLEINI_INLINE bool
+scan_number(std::string_view& str, scanned_number& number)
+{
+    const char* first = str.data();
+    const char* last = first + str.size();
+    auto integer = std::from_chars(first, last, number.integer);
+    if (integer.ec == std::errc() &&
+        (integer.ptr == last || *integer.ptr != '.')) {
+        number.is_integer = true;
+        str.remove_prefix(static_cast<std::size_t>(integer.ptr - first));
+        return true;
+    }
+    auto decimal =
+      std::from_chars(first, last, number.decimal, std::chars_format::fixed);
+    if (decimal.ec != std::errc()) {
+        return false;
+    }
+    number.is_integer = false;
+    str.remove_prefix(static_cast<std::size_t>(decimal.ptr - first));
+    return true;
+}
+
+/// Remove the unit name (letters and '%') at the start of @str and return it,
+/// skipping blanks around it.
+SIMPLEINI_INLINE std::string_view
+scan_unit(std::string_view& str)
+{
+    str = strip_leading(str);
+    std::size_t length = 0;
+    while (length < str.size()) {
+        char c = ascii_lower(str[length]);
+        if ((c < 'a' || c > 'z') && c != '%') {
+            break;
+        }
+        ++length;
+    }
+    std::string_view unit = str.substr(0, length);
+    str = strip_leading(str.substr(length));
+    return unit;
+}
+
+/// Scale of @unit in the table @units, compared ignoring ASCII case.
+template<std::size_t N>
+const std::uint64_t*
+find_unit(std::string_view unit,
+          const std::pair<std::string_view, std::uint64_t> (&units)[N])
+{
+    const key_less fold{ true };
+    for (const auto& [name, scale] : units) {
+        if (name.size() == unit.size() && fold.is_prefix(name, unit)) {
+            return &scale;
+        }
+    }
+    return nullptr;
+}
+
+/// Add @number times @scale to @total.
+/// @return false on overflow
+SIMPLEINI_INLINE bool
+add_scaled(long long& total, const scanned_number& number, std::uint64_t scale)
+{
+    constexpr auto max = std::numeric_limits<long long>::max();
+    long long scaled = 0;
+    if (number.is_integer) {
+        auto magnitude = number.integer < 0
+                           ? 0 - static_cast<std::uint64_t>(number.integer)
+                           : static_cast<std::uint64_t>(number.integer);
+        if (magnitude != 0 &&
+            scale > static_cast<std::uint64_t>(max) / magnitude) {
+            return false;
+        }
+        scaled = number.integer * static_cast<long long>(scale);
+    } else {
+        double value = number.decimal * static_cast<double>(scale);
+        if (!(std::fabs(value) < static_cast<double>(max))) {
+            return false;
+        }
+        scaled = std::llround(value);
+    }
+    if ((scaled > 0 && total > max - scaled) ||
+        (scaled < 0 && total < -max - scaled)) {
+        return false;
+    }
+    total += scaled;
+    return true;
+}
+
+SIMPLEINI_INLINE const char*
+scan_duration(std::string_view str, std::chrono::nanoseconds& duration)
+{
+    static constexpr std::pair<std::string_view, std::uint64_t> units[] = {
+        { "ns", 1 },
+        { "us", 1000 },
+        { "ms", 1000000 },
+        { "s", 1000000000 },
+        { "m", 60000000000 },
+        { "min", 60000000000 },
+        { "h", 3600000000000 },
+        { "d", 86400000000000 },
+    };
+    str = strip(str);
+    if (str.empty()) {
+        return "empty value";
+    }
+    long long total = 0;
+    while (!str.empty()) {
+        scanned_number number;
+        if (!scan_number(str, number)) {
+            return "expected a number";
+        }
+        std::string_view unit = scan_unit(str);
+        if (unit.empty()) {
+            return "missing unit (ns, us, ms, s, m, h or d)";
+        }
+        const auto* scale = find_unit(unit, units);
+        if (!scale) {
+            return "unknown unit (ns, us, ms, s, m, h or d)";
+        }
+        if (!add_scaled(total, number, *scale)) {
+            return "out of range";
+        }
+    }
+    duration = std::chrono::nanoseconds(total);
+    return nullptr;
+}
+
+SIMPLEINI_INLINE const char*
+scan_bytes(std::string_view str, std::uint64_t& bytes)
+{
+    static constexpr std::pair<std::string_view, std::uint64_t> units[] = {
+        { "", 1 },
+        { "b", 1 },
+        { "kb", 1000 },
+        { "mb", 1000000 },
+        { "gb", 1000000000 },
+        { "tb", 1000000000000 },
+        { "pb", 1000000000000000 },
+        { "k", 1ULL << 10 },
+        { "m", 1ULL << 20 },
+        { "g", 1ULL << 30 },
+        { "t", 1ULL << 40 },
+        { "p", 1ULL << 50 },
+        { "kib", 1ULL << 10 },
+        { "mib", 1ULL << 20 },
+        { "gib", 1ULL << 30 },
+        { "tib", 1ULL << 40 },
+        { "pib", 1ULL << 50 },
+    };
+    str = strip(str);
+    scanned_number number;
+    if (!scan_number(str, number)) {
+        return "expected a number";
+    }
+    if (number.is_integer ? number.integer < 0 : number.decimal < 0) {
+        return "negative size";
+    }
+    const auto* scale = find_unit(scan_unit(str), units);
+    if (!scale || !str.empty()) {
+        return "unknown unit (B, KB, KiB, MB, MiB, GB, GiB, TB, TiB)";
+    }
+    long long total = 0;
+    if (!add_scaled(total, number, *scale)) {
+        return "out of range";
+    }
+    bytes = static_cast<std::uint64_t>(total);
+    return nullptr;
+}
+
+SIMPLEINI_INLINE const char*
+scan_percent(std::string_view str, double& ratio)
+{
+    str = strip(str);
+    scanned_number number;
+    if (!scan_number(str, number)) {
+        return "expected a number";
+    }
+    if (scan_unit(str) != "%" || !str.empty()) {
+        return "expected a number followed by '%'";
+    }
+    double value = number.is_integer ? static_cast<double>(number.integer)
+                                     : number.decimal;
+    ratio = value / 100;
+    return nullptr;
+}
+
+template<typename T>
+bool
+stream_value(const std::string& value, T& out)
+{
+    return stream_value(value, &out, [](std::istream& input, void* read) {
+        input >> *static_cast<T*>(read);
+    });
+}
+
+SIMPLEINI_INLINE bool
+stream_value(const std::string& value,
+             void* out,
+             void (*read)(std::istream& input, void* out))
+{
+    std::istringstream input(value);
+    read(input, out);
+    return !input.fail();
+}
+
+SIMPLEINI_INLINE
+INISection::INISection(std::string name,
+                       std::map<std::string, std::string> content)
+  : m_name(std::move(name))
+  , m_body(std::make_shared<body>())
+{
+    key_map sorted;
+    sorted.merge(content);
+    m_body->contents = name_table<std::string>(std::move(sorted));
+}
+
+SIMPLEINI_INLINE
+INISection::INISection(std::string name,
+                       key_map content,
+                       const INIOptions& options)
+  : m_name(std::move(name))
+  , m_body(std::make_shared<body>())
+{
+    if (!options.preserve_order &&
+        content.key_comp().case_insensitive == options.case_insensitive) {
+        m_body->contents = name_table<std::string>(std::move(content));
+        return;
+    }
+    m_body->contents = name_table<std::string>(
+      key_less{ options.case_insensitive }, options.preserve_order);
+    while (!content.empty()) {
+        auto node = content.extract(content.begin());
+        m_body->contents.try_emplace(std::move(node.key()),
+                                     std::move(node.mapped()));
+    }
+}
+
+SIMPLEINI_INLINE bool
+INISection::get_bool(std::string_view key) const
+{
+    const INIValue* typed = get_typed(key);
+    std::optional<INIValue> decoded;
+    if (!typed) {
+        decoded = decode_value(get(key));
+        typed = decoded ? &*decoded : nullptr;
+    }
+    if (typed) {
+        if (const auto* flag = std::get_if<bool>(typed)) {
+            return *flag;
+        }
+        if (const auto* integer = std::get_if<long long>(typed);
+            integer && (*integer == 0 || *integer == 1)) {
+            return *integer == 1;
+        }
+    }
+    invalid_value("boolean",
+                  key,
+                  get(key),
+                  "expected true/false, yes/no, on/off or 1/0");
+}
+
+SIMPLEINI_INLINE void
+INISection::set(std::string key, std::string value)
+{
+    auto& contents = mutable_body();
+    if (!contents.typed.empty()) {
+        contents.typed.erase(key);
+    }
+    contents.contents.insert_or_assign(std::move(key), std::move(value));
+}
+
+SIMPLEINI_INLINE void
+INISection::decode()
+{
+    auto& contents = mutable_body();
+    contents.typed = std::map<std::string, INIValue, key_less>(
+      contents.contents.key_comp());
+    for (const auto& [key, value] : contents.contents) {
+        if (auto typed = decode_value(value)) {
+            contents.typed.try_emplace(key, *typed);
+        }
+    }
+}
+
+SIMPLEINI_INLINE bool
+INISection::emplace(std::string key, std::string value)
+{
+    return mutable_body()
+      .contents.try_emplace(std::move(key), std::move(value))
+      .second;
+}
+
+SIMPLEINI_INLINE std::map<std::string, std::string>
+INISection::get_map() const
+{
+    return { contents().begin(), contents().end() };
+}
+
+SIMPLEINI_INLINE std::map<std::string, std::string>
+INISection::take_map()
+{
+    std::map<std::string, std::string> contents;
+    if (m_body) {
+        auto& taken = mutable_body();
+        contents = taken.contents.take();
+        taken.typed.clear();
+    }
+    return contents;
+}
+
+SIMPLEINI_INLINE std::shared_ptr<INISection::body>
+INISection::copy_body() const
+{
+    if (!m_body || m_body->interned) {
+        return m_body;
+    }
+    return std::make_shared<body>(body{ m_body->contents, m_body->typed });
+}
+
+SIMPLEINI_INLINE INISection::body&
+INISection::mutable_body()
+{
+    if (!m_body) {
+        m_body = std::make_shared<body>();
+    } else if (m_body->interned) {
+        m_body = std::make_shared<body>(
+          body{ m_body->contents, m_body->typed });
+    }
+    return *m_body;
+}
+
+SIMPLEINI_INLINE std::map<std::string, INISection>
+SimpleINI::get_map() const
+{
+    return { m_sections.begin(), m_sections.end() };
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::add_section(const std::string& name, const INISection& section)
+{
+    m_sections.insert_or_assign(name, section);
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::add_section(const std::string& name, INISection&& section)
+{
+    m_sections.insert_or_assign(name, std::move(section));
+}
+
+SIMPLEINI_INLINE INISection&
+SimpleINI::emplace_section(const std::string& name)
+{
+    return *m_sections.try_emplace(name, name, key_map{}, m_options).first;
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::set(const std::string& section, std::string key, std::string value)
+{
+    emplace_section(section).set(std::move(key), std::move(value));
+}
+
+struct SimpleINI::section_builder
+{
+    section_builder(name_table<INISection>& target,
+                    const INIOptions& load_options)
+      : sections(target)
+      , options(load_options){};
+
+    name_table<INISection>& sections;
+    const INIOptions& options;
+    // Section receiving keys, null while skipping a repeated section
+    INISection* current = nullptr;
+
+    bool on_section(std::string_view name)
+    {
+        current = nullptr;
+        if (!options.wants_section(name)) {
+            return false;
+        }
+        if (!name.empty()) {
+            auto [section, added] = sections.try_emplace(
+              std::string(name), std::string(name), key_map{}, options);
+            current = added ? section : nullptr;
+        }
+        return true;
+    }
+
+    void on_key_value(std::string_view key, std::string_view value)
+    {
+        if (current) {
+            current->emplace(std::string(key), std::string(value));
+        }
+    }
+};
+
+SIMPLEINI_INLINE std::string
+INISection::as_string() const
+{
+    std::string config_section;
+    config_section += "[" + m_name + "]\n";
+    for (const auto& content : contents()) {
+        config_section += content.first + " = " + content.second + "\n";
+    }
+    return config_section;
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::write() const
+{
+    std::string config;
+    for (const auto& section : m_sections) {
+        config += section.second.as_string();
+    }
+    std::ofstream config_of(m_path);
+    config_of << config;
+    config_of.close();
+}
+
+SIMPLEINI_INLINE std::string
+read_file(const std::filesystem::path& path, const INILimits& limits)
+{
+    std::error_code ec;
+    const auto status = std::filesystem::status(path, ec);
+    if (!std::filesystem::exists(status)) {
+        throw INIException("File not found:" + path.string());
+    }
+    auto too_large = [&] {
+        return INIException("File " + path.string() +
+                            " exceeds the maximum input size of " +
+                            std::to_string(limits.max_file_size));
+    };
+
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw INIException("Can't read file " + path.string());
+    }
+    std::string content;
+    if (std::filesystem::is_regular_file(status)) {
+        const auto size = std::filesystem::file_size(path);
+        if (size > limits.max_file_size) {
+            throw too_large();
+        }
+        content.resize(size);
+        input.read(content.data(), static_cast<std::streamsize>(size));
+        content.resize(static_cast<std::size_t>(input.gcount()));
+        return content;
+    }
+
+    char chunk[65536];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        const auto count = static_cast<std::size_t>(input.gcount());
+        if (count > limits.max_file_size - content.size()) {
+            throw too_large();
+        }
+        content.append(chunk, count);
+    }
+    return content;
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::read_content()
+{
+    // Parse views into the file content, so every value is copied once,
+    // into its section.
+    const std::string content = read_file(m_path, m_options.limits);
+
+    m_sections.clear();
+    section_builder builder{ m_sections, m_options };
+    parse(std::string_view(content),
+          builder,
+          m_options.limits,
+          m_options.syntax);
+
+    if (m_options.decode_types) {
+        decode_sections();
+    }
+    if (m_options.section_store) {
+        m_sections.for_each([&](const std::string&, INISection& section) {
+            m_options.section_store->intern(section);
+        });
+    }
+}
+
+SIMPLEINI_INLINE void
+SimpleINI::decode_sections()
+{
+    // Spread sections over threads only when there is enough work to
+    // outweigh starting them.
+    constexpr std::size_t keys_per_thread = 16384;
+    std::vector<INISection*> sections;
+    std::size_t keys = 0;
+    m_sections.for_each([&](const std::string&, INISection& section) {
+        sections.push_back(&section);
+        keys += section.size();
+    });
+
+    std::size_t threads =
+      std::min<std::size_t>({ std::thread::hardware_concurrency(),
+                              sections.size(),
+                              keys / keys_per_thread });
+    std::atomic<std::size_t> next{ 0 };
+    auto decode = [&] {
+        for (std::size_t i = next++; i < sections.size(); i = next++) {
+            sections[i]->decode();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(decode);
+    }
+    decode();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+}
+#endif
+
+#ifdef SIMPLEINI_COMPILED
+namespace simpleini {
+extern template int
+INISection::get_as<int>(std::string_view) const;
+extern template long
+INISection::get_as<long>(std::string_view) const;
+extern template long long
+INISection::get_as<long long>(std::string_view) const;
+extern template unsigned
+INISection::get_as<unsigned>(std::string_view) const;
+extern template float
+INISection::get_as<float>(std::string_view) const;
+extern template double
+INISection::get_as<double>(std::string_view) const;
+extern template std::string
+INISection::get_as<std::string>(std::string_view) const;
+}
+#endif
 
 #endif
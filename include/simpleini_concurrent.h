@@ -0,0 +1,215 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_CONCURRENT_H
+#define _SIMPLEINI_CONCURRENT_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "simpleini.h"
+
+namespace simpleini {
+
+/// @brief Configuration that can be read and modified from several threads.
+/// Each section has its own reader-writer lock, so writers only block
+/// readers and writers of the same section. Sections are found without
+/// locking: sections are never removed, and adding one only fills an empty
+/// slot of the section table, or publishes a larger copy of it.
+SIMPLEINI_EXPORT class ConcurrentINI
+{
+  public:
+    ConcurrentINI() { grow(0); };
+
+    /// @brief Create a ConcurrentINI holding a copy of @config
+    explicit ConcurrentINI(const SimpleINI& config)
+      : m_options(config.get_options())
+    {
+        grow(config.size());
+        for (const auto& [name, section] : config) {
+            add(name, section);
+        }
+    };
+
+    ConcurrentINI(const ConcurrentINI&) = delete;
+    ConcurrentINI& operator=(const ConcurrentINI&) = delete;
+
+    /// @brief Return a copy of the value of @key in section @section
+    /// @throws std::out_of_range if the section or key doesn't exist
+    std::string get(std::string_view section, std::string_view key) const
+    {
+        const shard& found = find_shard(section);
+        std::shared_lock section_lock(found.mutex);
+        return found.section.get(key);
+    };
+
+    /// @brief Get value of @key in section @section as type T
+    /// @throws INIException if conversion to type T fails.
+    /// @throws std::out_of_range if the section or key doesn't exist
+    template<typename T>
+    T get_as(std::string_view section, std::string_view key) const
+    {
+        const shard& found = find_shard(section);
+        std::shared_lock section_lock(found.mutex);
+        return found.section.template get_as<T>(key);
+    }
+
+    /// @brief Return a copy of section @section
+    /// @throws std::out_of_range if the section doesn't exist
+    INISection section(std::string_view section) const
+    {
+        const shard& found = find_shard(section);
+        std::shared_lock section_lock(found.mutex);
+        return found.section;
+    };
+
+    /// @brief Set the value of @key in section @section, creating the
+    /// section if needed.
+    void set(std::string_view section, std::string key, std::string value)
+    {
+        shard* found = find(section);
+        if (!found) {
+            std::lock_guard writer_lock(m_writer);
+            found = find(section);
+            if (!found) {
+                found = &add(std::string(section),
+                             INISection{
+                               std::string(section), key_map{}, m_options });
+            }
+        }
+        std::unique_lock section_lock(found->mutex);
+        found->section.set(std::move(key), std::move(value));
+    };
+
+    /// @brief Copy the current configuration into a SimpleINI. Each section
+    /// is copied consistently, but sections may be modified in between.
+    SimpleINI snapshot() const
+    {
+        SimpleINI config(m_options);
+        std::lock_guard writer_lock(m_writer);
+        for (const shard& found : m_shards) {
+            std::shared_lock section_lock(found.mutex);
+            config.add_section(found.name, found.section);
+        }
+        return config;
+    };
+
+  private:
+    struct shard
+    {
+        shard(std::string name, INISection content)
+          : name(std::move(name))
+          , section(std::move(content)){};
+
+        const std::string name;
+        mutable std::shared_mutex mutex;
+        INISection section;
+    };
+
+    /// Open addressing table of shards, at most half full so every probe
+    /// ends at an empty slot. Slots only change from empty to a shard.
+    struct table
+    {
+        explicit table(std::size_t capacity)
+          : slots(capacity){};
+
+        std::vector<std::atomic<shard*>> slots;
+    };
+
+    INIOptions m_options;
+    name_hash m_hash{ m_options.case_insensitive };
+    name_equal m_equal{ m_options.case_insensitive };
+    // Taken to add sections, never by readers
+    mutable std::mutex m_writer;
+    // Shards in the order they were added, never moved
+    std::deque<shard> m_shards;
+    // Every table published, as readers may still probe replaced ones. The
+    // capacities double, so replaced tables take less than the current one.
+    std::vector<std::unique_ptr<table>> m_tables;
+    std::atomic<const table*> m_table = nullptr;
+
+    shard* find(std::string_view section) const
+    {
+        const table* current = m_table.load(std::memory_order_acquire);
+        const std::size_t mask = current->slots.size() - 1;
+        for (std::size_t i = m_hash(section) & mask;; i = (i + 1) & mask) {
+            shard* found = current->slots[i].load(std::memory_order_acquire);
+            if (!found || m_equal(found->name, section)) {
+                return found;
+            }
+        }
+    }
+
+    const shard& find_shard(std::string_view section) const
+    {
+        const shard* found = find(section);
+        if (!found) {
+            throw std::out_of_range("No section '" + std::string(section) +
+                                    "'");
+        }
+        return *found;
+    }
+
+    /// Add a shard for the section @name, which must not exist yet. Called
+    /// with m_writer held, or from a constructor.
+    shard& add(std::string name, INISection section)
+    {
+        shard& added = m_shards.emplace_back(std::move(name), std::move(section));
+        if (m_shards.size() * 2 > m_tables.back()->slots.size()) {
+            grow(m_shards.size());
+        } else {
+            insert(*m_tables.back(), added);
+        }
+        return added;
+    }
+
+    /// Publish a table with room for @sections shards holding all shards
+    void grow(std::size_t sections)
+    {
+        std::size_t capacity = 16;
+        while (capacity < sections * 2) {
+            capacity *= 2;
+        }
+        auto larger = std::make_unique<table>(capacity);
+        for (shard& existing : m_shards) {
+            insert(*larger, existing);
+        }
+        m_table.store(larger.get(), std::memory_order_release);
+        m_tables.push_back(std::move(larger));
+    }
+
+    void insert(table& into, shard& added)
+    {
+        const std::size_t mask = into.slots.size() - 1;
+        std::size_t i = m_hash(added.name) & mask;
+        while (into.slots[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & mask;
+        }
+        into.slots[i].store(&added, std::memory_order_release);
+    }
+};
+}
+
+#endif
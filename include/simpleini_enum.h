@@ -0,0 +1,173 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Lookup of enum values by name for INISection::get_as<E>(), see
+// enum_names.
+
+// Before the include guard, like in simpleini_parser.h.
+#include "simpleini.h"
+
+#ifndef _SIMPLEINI_ENUM_H
+#define _SIMPLEINI_ENUM_H
+
+#include <array>
+#include <bit>
+#include <numeric>
+
+namespace simpleini {
+
+/// Perfect hash table over enum_names<E>, built at compile time so a lookup
+/// is one hash and one string compare. Built by hash and displace: names are
+/// grouped into buckets by their hash, and the buckets, largest first, each
+/// get the first displacement that moves all their names to free slots. That
+/// takes a few tries per bucket, however many names there are.
+SIMPLEINI_EXPORT template<typename E>
+class enum_table
+{
+    static constexpr auto& names = enum_names<E>::names;
+    static constexpr std::size_t count = std::size(names);
+    static constexpr std::size_t slots = std::bit_ceil(count * 2);
+    static constexpr std::size_t buckets = std::bit_ceil(count);
+    static constexpr std::uint32_t max_displacement = 1 << 16;
+
+    static constexpr std::uint64_t hash(std::string_view name)
+    {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        // FNV only carries changes upwards, mix so every bit of the bucket
+        // and slot depends on every character
+        hash = (hash ^ (hash >> 32)) * 0xd6e8feb86659fd93ULL;
+        return hash ^ (hash >> 32);
+    }
+
+    static constexpr std::size_t bucket(std::uint64_t hash)
+    {
+        return static_cast<std::size_t>(hash >> 32) & (buckets - 1);
+    }
+
+    static constexpr std::size_t slot(std::uint64_t hash,
+                                      std::uint32_t displacement)
+    {
+        hash ^= displacement * 0x9e3779b97f4a7c15ULL;
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        return static_cast<std::size_t>(hash ^ (hash >> 31)) & (slots - 1);
+    }
+
+    struct table
+    {
+        std::array<std::uint32_t, buckets> displacement{};
+        std::array<std::size_t, slots> index{}; ///< entry + 1, 0 if free
+        bool unique = true;
+        bool found = true;
+    };
+
+    static constexpr table build()
+    {
+        table result;
+        std::array<std::uint64_t, count> hashes{};
+        std::array<std::size_t, buckets> sizes{};
+        for (std::size_t i = 0; i < count; ++i) {
+            hashes[i] = hash(names[i].first);
+            ++sizes[bucket(hashes[i])];
+        }
+        std::array<std::size_t, count> order{};
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+            auto left = bucket(hashes[lhs]), right = bucket(hashes[rhs]);
+            return sizes[left] != sizes[right] ? sizes[left] > sizes[right]
+                                               : left < right;
+        });
+
+        for (std::size_t first = 0; first < count;) {
+            std::size_t group = bucket(hashes[order[first]]);
+            std::size_t last = first + sizes[group];
+            for (std::size_t i = first; i < last; ++i) {
+                for (std::size_t j = i + 1; j < last; ++j) {
+                    if (names[order[i]].first == names[order[j]].first) {
+                        result.unique = false;
+                        return result;
+                    }
+                }
+            }
+            std::uint32_t displacement = 0;
+            for (; displacement < max_displacement; ++displacement) {
+                std::size_t placed = first;
+                while (placed < last &&
+                       result.index[slot(hashes[order[placed]],
+                                         displacement)] == 0) {
+                    result.index[slot(hashes[order[placed]], displacement)] =
+                      order[placed] + 1;
+                    ++placed;
+                }
+                if (placed == last) {
+                    break;
+                }
+                for (std::size_t i = first; i < placed; ++i) {
+                    result.index[slot(hashes[order[i]], displacement)] = 0;
+                }
+            }
+            if (displacement == max_displacement) {
+                result.found = false;
+                return result;
+            }
+            result.displacement[group] = displacement;
+            first = last;
+        }
+        return result;
+    }
+
+    static constexpr table lookup = build();
+    static_assert(lookup.unique, "enum names must be unique");
+    static_assert(lookup.found, "no perfect hash found for the enum names");
+
+  public:
+    /// @brief Find the value named @name
+    /// @return pointer to the value, or nullptr if no value has that name
+    static constexpr const E* find(std::string_view name)
+    {
+        std::uint64_t hashed = hash(name);
+        std::size_t entry =
+          lookup.index[slot(hashed, lookup.displacement[bucket(hashed)])];
+        if (entry == 0 || names[entry - 1].first != name) {
+            return nullptr;
+        }
+        return &names[entry - 1].second;
+    }
+
+    /// @brief Comma separated list of the valid names
+    static std::string valid_names()
+    {
+        std::string list;
+        for (const auto& entry : names) {
+            if (!list.empty()) {
+                list += ", ";
+            }
+            list += entry.first;
+        }
+        return list;
+    }
+};
+}
+
+#endif
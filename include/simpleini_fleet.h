@@ -0,0 +1,366 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_FLEET_H
+#define _SIMPLEINI_FLEET_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "simpleini.h"
+#include "simpleini_parser.h"
+
+namespace simpleini {
+
+/// @brief Values of one section and key across all hosts of an INIFleet.
+/// Each distinct value is stored once in a dictionary and every host holds
+/// a code into it, 0 meaning the host doesn't set the key.
+SIMPLEINI_EXPORT class INIColumn
+{
+  public:
+    using code = std::uint32_t;
+    static constexpr code missing = 0;
+
+    /// @brief Distinct values, value of code c is dictionary()[c - 1]
+    const std::deque<std::string>& dictionary() const { return m_dictionary; };
+
+    /// @brief Code of the value of every host
+    const std::vector<code>& codes() const { return m_codes; };
+
+    /// @brief Value of host @host
+    /// @return pointer to the value, or nullptr if the host doesn't set it
+    const std::string* value(std::size_t host) const
+    {
+        code c = m_codes.at(host);
+        return c == missing ? nullptr : &m_dictionary[c - 1];
+    };
+
+  private:
+    friend class INIFleet;
+
+    /// Codes of the dictionary values, only kept while loading
+    using value_index = std::unordered_map<std::string_view, code>;
+
+    /// Set the value of @host unless it has one, the first value of a
+    /// repeated key wins like in SimpleINI. @index holds the codes of the
+    /// values set so far.
+    void set(std::size_t host, std::string_view value, value_index& index)
+    {
+        m_codes.resize(std::max(m_codes.size(), host + 1), missing);
+        if (m_codes[host] != missing) {
+            return;
+        }
+        auto it = index.find(value);
+        if (it == index.end()) {
+            // Key the index with the stored copy, deque elements don't move
+            m_dictionary.emplace_back(value);
+            it = index
+                   .emplace(m_dictionary.back(),
+                            static_cast<code>(m_dictionary.size()))
+                   .first;
+        }
+        m_codes[host] = it->second;
+    }
+
+    std::deque<std::string> m_dictionary;
+    std::vector<code> m_codes;
+};
+
+/// @brief Column store over the configurations of many hosts, one INI file
+/// per host. Files are parsed in parallel and each section and key becomes
+/// an INIColumn, so a query touches only the columns it names and evaluates
+/// its predicate once per distinct value. Hosts are merged in order as their
+/// files are parsed, so loading holds the columns plus the files parsed ahead
+/// of the next host to merge.
+SIMPLEINI_EXPORT class INIFleet
+{
+  public:
+    using host_id = std::size_t;
+
+    INIFleet(){};
+
+    /// @brief Load @files, one host per file, with the name matching, section
+    /// allowlist and limits of @options
+    /// @throws INIException if a file can't be read or parsed
+    explicit INIFleet(std::vector<std::filesystem::path> files,
+                      const INIOptions& options = {})
+      : m_hosts(std::move(files))
+      , m_options(options)
+      , m_columns(key_less{ options.case_insensitive })
+    {
+        load();
+    };
+
+    /// @brief Number of hosts
+    std::size_t hosts() const { return m_hosts.size(); };
+
+    /// @brief File the configuration of @host was loaded from
+    const std::filesystem::path& host(host_id host) const
+    {
+        return m_hosts.at(host);
+    };
+
+    /// @brief Column of key @key in section @section
+    /// @return pointer to the column, or nullptr if no host sets the key
+    const INIColumn* column(std::string_view section,
+                            std::string_view key) const
+    {
+        auto it = m_columns.find(section);
+        if (it == m_columns.end()) {
+            return nullptr;
+        }
+        auto column = it->second.find(key);
+        return column == it->second.end() ? nullptr : &column->second;
+    };
+
+    /// @brief Hosts whose value of @section @key, converted to T, satisfies
+    /// @predicate. T is std::string_view or an arithmetic type; hosts whose
+    /// value doesn't convert to T don't match.
+    template<typename T = std::string_view, typename Predicate>
+    std::vector<host_id> filter(std::string_view section,
+                                std::string_view key,
+                                Predicate predicate) const
+    {
+        std::vector<host_id> selected;
+        const INIColumn* values = column(section, key);
+        if (!values) {
+            return selected;
+        }
+
+        // Evaluate the predicate once per distinct value, then select hosts
+        // with a branch-free lookup per code.
+        std::vector<std::uint8_t> matches(values->dictionary().size() + 1, 0);
+        for (std::size_t i = 0; i < values->dictionary().size(); ++i) {
+            T value;
+            if (convert(values->dictionary()[i], value)) {
+                matches[i + 1] = predicate(value) ? 1 : 0;
+            }
+        }
+        const auto& codes = values->codes();
+        selected.resize(codes.size());
+        std::size_t count = 0;
+        for (std::size_t host = 0; host < codes.size(); ++host) {
+            selected[count] = host;
+            count += matches[codes[host]];
+        }
+        selected.resize(count);
+        return selected;
+    }
+
+    /// @brief Number of hosts per distinct value of @section @key, in the
+    /// order the values were first seen. Hosts not setting the key aren't
+    /// counted.
+    std::vector<std::pair<std::string_view, std::size_t>> group_by(
+      std::string_view section,
+      std::string_view key) const
+    {
+        std::vector<std::pair<std::string_view, std::size_t>> groups;
+        const INIColumn* values = column(section, key);
+        if (!values) {
+            return groups;
+        }
+        std::vector<std::size_t> counts(values->dictionary().size() + 1, 0);
+        for (auto code : values->codes()) {
+            ++counts[code];
+        }
+        for (std::size_t i = 0; i < values->dictionary().size(); ++i) {
+            if (counts[i + 1] != 0) {
+                groups.emplace_back(values->dictionary()[i], counts[i + 1]);
+            }
+        }
+        return groups;
+    };
+
+  private:
+    // Entries of one file as views into its content, kept until merged.
+    // Unescaped and continued values only live in the parser during the
+    // callback, so they are copied into owned. Not moved once parsed, since
+    // moving a short content string moves the characters the views point to.
+    struct host_entries
+    {
+        std::string content;
+        std::deque<std::string> owned;
+        std::vector<std::array<std::string_view, 3>> entries;
+
+        std::string_view keep(std::string_view str)
+        {
+            const std::less<const char*> before;
+            const char* first = content.data();
+            const char* last = first + content.size();
+            if (!before(str.data(), first) &&
+                !before(last, str.data() + str.size())) {
+                return str;
+            }
+            return owned.emplace_back(str);
+        }
+    };
+
+    // Collects entries like SimpleINI's section_builder: keys before the
+    // first section header, in sections named "" and in repeated sections
+    // are dropped. Repeated keys are dropped when merging.
+    struct entry_builder
+    {
+        explicit entry_builder(host_entries& host, const INIOptions& options)
+          : m_host(host)
+          , m_options(options)
+          , m_seen(key_less{ options.case_insensitive }){};
+
+        bool on_section(std::string_view name)
+        {
+            m_active = false;
+            if (!m_options.wants_section(name)) {
+                return false;
+            }
+            if (!name.empty()) {
+                m_section = m_host.keep(name);
+                m_active = m_seen.insert(m_section).second;
+            }
+            return true;
+        }
+
+        void on_key_value(std::string_view key, std::string_view value)
+        {
+            if (m_active) {
+                m_host.entries.push_back(
+                  { m_section, m_host.keep(key), m_host.keep(value) });
+            }
+        }
+
+        host_entries& m_host;
+        const INIOptions& m_options;
+        std::set<std::string_view, key_less> m_seen;
+        std::string_view m_section;
+        bool m_active = false;
+    };
+
+    void load()
+    {
+        std::vector<std::promise<std::unique_ptr<host_entries>>> parsed(
+          m_hosts.size());
+        std::atomic<std::size_t> next{ 0 };
+        auto work = [&] {
+            for (std::size_t i = next++; i < parsed.size(); i = next++) {
+                try {
+                    auto host = std::make_unique<host_entries>();
+                    read(m_hosts[i], *host);
+                    parsed[i].set_value(std::move(host));
+                } catch (...) {
+                    parsed[i].set_exception(std::current_exception());
+                }
+            }
+        };
+        std::size_t threads = std::min<std::size_t>(
+          std::max(std::thread::hardware_concurrency(), 1U), m_hosts.size());
+        // Declared after parsed, so the workers are joined before it goes
+        std::vector<std::jthread> workers;
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+
+        std::unordered_map<const INIColumn*, INIColumn::value_index> indexes;
+        for (host_id host = 0; host < parsed.size(); ++host) {
+            std::unique_ptr<host_entries> entries;
+            try {
+                entries = parsed[host].get_future().get();
+            } catch (...) {
+                // Leave the files not started yet
+                next = parsed.size();
+                throw;
+            }
+            for (const auto& [section, key, value] : entries->entries) {
+                auto it = m_columns.find(section);
+                if (it == m_columns.end()) {
+                    it = m_columns
+                           .emplace(section,
+                                    column_map(key_less{
+                                      m_options.case_insensitive }))
+                           .first;
+                }
+                auto column = it->second.find(key);
+                if (column == it->second.end()) {
+                    column = it->second.emplace(key, INIColumn{}).first;
+                }
+                column->second.set(host, value, indexes[&column->second]);
+            }
+        }
+        for (auto& [section, columns] : m_columns) {
+            for (auto& [key, column] : columns) {
+                column.m_codes.resize(m_hosts.size(), INIColumn::missing);
+            }
+        }
+    }
+
+    void read(const std::filesystem::path& path, host_entries& host) const
+    {
+        host.content = read_file(path, m_options.limits);
+        entry_builder builder{ host, m_options };
+        parse(std::string_view(host.content),
+              builder,
+              m_options.limits,
+              m_options.syntax);
+    }
+
+    template<typename T>
+    static bool convert(std::string_view str, T& value)
+    {
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            value = str;
+            return true;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            auto decoded = decode_value(str);
+            if (!decoded || !std::holds_alternative<bool>(*decoded)) {
+                return false;
+            }
+            value = std::get<bool>(*decoded);
+            return true;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            // The whole value has to be a number, like for integers
+            const char* last = str.data() + str.size();
+            auto [end, ec] = from_chars_floating(str.data(), last, value);
+            return ec == std::errc() && end == last;
+        } else {
+            static_assert(std::is_integral_v<T>,
+                          "filter() supports std::string_view and arithmetic "
+                          "types");
+            auto [end, ec] =
+              std::from_chars(str.data(), str.data() + str.size(), value);
+            return ec == std::errc() && end == str.data() + str.size();
+        }
+    }
+
+    using column_map = std::map<std::string, INIColumn, key_less>;
+
+    std::vector<std::filesystem::path> m_hosts;
+    INIOptions m_options;
+    std::map<std::string, column_map, key_less> m_columns;
+};
+}
+
+#endif
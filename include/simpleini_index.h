@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_INDEX_H
+#define _SIMPLEINI_INDEX_H
+
+#include <cstdint>
+
+#include "simpleini.h"
+
+namespace simpleini {
+
+/// @brief Read-only copy of a configuration where sections and keys are
+/// numbered densely. Names are resolved to ids once, after which a value is
+/// fetched with a single load from a contiguous array.
+///
+/// Section ids are 0..sections()-1. Key ids are offsets into the value array:
+/// the keys of section s are numbered first_key(s)..first_key(s + 1)-1.
+SIMPLEINI_EXPORT class INIIndex
+{
+  public:
+    using id = std::uint32_t;
+
+    INIIndex(){};
+
+    /// @brief Number the sections and keys of @config
+    explicit INIIndex(const SimpleINI& config)
+      : m_less{ config.get_options().case_insensitive }
+    {
+        m_section_names.reserve(config.size());
+        m_offsets.reserve(config.size() + 1);
+        for (const auto* entry : by_name(config)) {
+            m_section_names.push_back(entry->first);
+            m_offsets.push_back(static_cast<id>(m_values.size()));
+            for (const auto* item : by_name(entry->second)) {
+                m_key_names.push_back(item->first);
+                m_values.push_back(item->second);
+            }
+        }
+        m_offsets.push_back(static_cast<id>(m_values.size()));
+    };
+
+    /// @brief Resolve the id of section @name
+    /// @throws std::out_of_range if the section doesn't exist
+    id section(std::string_view name) const
+    {
+        auto it = std::lower_bound(
+          m_section_names.begin(), m_section_names.end(), name, m_less);
+        if (it == m_section_names.end() || m_less(name, *it)) {
+            throw std::out_of_range("No section '" + std::string(name) + "'");
+        }
+        return static_cast<id>(it - m_section_names.begin());
+    };
+
+    /// @brief Resolve the id of @key in section @section
+    /// @throws std::out_of_range if the section id or key doesn't exist
+    id key(id section, std::string_view key) const
+    {
+        auto first = m_key_names.begin() + first_key(section);
+        auto last = m_key_names.begin() + first_key(section + 1);
+        auto it = std::lower_bound(first, last, key, m_less);
+        if (it == last || m_less(key, *it)) {
+            throw std::out_of_range("No key '" + std::string(key) +
+                                    "' in section '" +
+                                    m_section_names[section] + "'");
+        }
+        return static_cast<id>(it - m_key_names.begin());
+    };
+
+    /// @brief Resolve the id of @key in section @section
+    /// @throws std::out_of_range if the section or key doesn't exist
+    id key(std::string_view section, std::string_view key) const
+    {
+        return this->key(this->section(section), key);
+    };
+
+    /// @brief Value of key @key_id. The id must come from key().
+    const std::string& operator[](id key_id) const { return m_values[key_id]; };
+
+    /// @brief Id of the first key of section @section. first_key(sections())
+    /// is the total number of keys.
+    /// @throws std::out_of_range if the section id doesn't exist
+    id first_key(id section) const { return m_offsets.at(section); };
+
+    /// @brief Number of sections
+    std::size_t sections() const { return m_section_names.size(); };
+
+    /// @brief Number of keys in all sections
+    std::size_t size() const { return m_values.size(); };
+
+    /// @brief Name of section @section
+    const std::string& section_name(id section) const
+    {
+        return m_section_names.at(section);
+    };
+
+    /// @brief Name of key @key_id
+    const std::string& key_name(id key_id) const
+    {
+        return m_key_names.at(key_id);
+    };
+
+  private:
+    /// Entries of @range sorted by name, ids are assigned in name order so
+    /// names can be resolved by binary search.
+    template<typename Range>
+    std::vector<const typename Range::const_iterator::value_type*> by_name(
+      const Range& range) const
+    {
+        std::vector<const typename Range::const_iterator::value_type*> entries;
+        entries.reserve(range.size());
+        for (const auto& entry : range) {
+            entries.push_back(&entry);
+        }
+        auto less = [this](const auto* lhs, const auto* rhs) {
+            return m_less(lhs->first, rhs->first);
+        };
+        if (!std::is_sorted(entries.begin(), entries.end(), less)) {
+            std::sort(entries.begin(), entries.end(), less);
+        }
+        return entries;
+    }
+
+    key_less m_less;
+    std::vector<std::string> m_section_names;
+    std::vector<id> m_offsets;
+    std::vector<std::string> m_key_names;
+    std::vector<std::string> m_values;
+};
+}
+
+#endif
@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_NOTIFY_H
+#define _SIMPLEINI_NOTIFY_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <optional>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "simpleini_socket.h"
+
+namespace simpleini {
+
+/// @brief Generation number of the configuration file at @path, derived from
+/// its modification and status change times, size and inode so that every
+/// process computes the same value. A file rewritten or replaced within the
+/// resolution of its modification time still gets a new generation.
+/// @return the generation, 0 with @ec set if the file can't be stat()ed
+inline std::uint64_t
+config_generation(const std::filesystem::path& path, std::error_code& ec)
+{
+    struct stat status;
+    if (::stat(path.c_str(), &status) != 0) {
+        ec.assign(errno, std::generic_category());
+        return 0;
+    }
+    ec.clear();
+    auto nanoseconds = [](const timespec& time) {
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 +
+               static_cast<std::uint64_t>(time.tv_nsec);
+    };
+    std::uint64_t generation = 0;
+    for (std::uint64_t field : { nanoseconds(status.st_mtim),
+                                 nanoseconds(status.st_ctim),
+                                 static_cast<std::uint64_t>(status.st_size),
+                                 static_cast<std::uint64_t>(status.st_ino),
+                                 static_cast<std::uint64_t>(status.st_dev) }) {
+        generation ^= field + 0x9e3779b97f4a7c15ULL + (generation << 6) +
+                      (generation >> 2);
+    }
+    return generation;
+}
+
+/// @brief Generation number of the configuration file at @path
+/// @throws std::filesystem::filesystem_error if the file can't be stat()ed
+inline std::uint64_t
+config_generation(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    std::uint64_t generation = config_generation(path, ec);
+    if (ec) {
+        throw std::filesystem::filesystem_error("config_generation", path, ec);
+    }
+    return generation;
+}
+
+/// @brief Local broadcast channel for configuration reloads (POSIX only).
+/// Every process joining the channel binds a Unix datagram socket in
+/// @directory. One process detects a change and broadcast()s a generation
+/// number to all of them, so the others only wait on their socket instead of
+/// polling the configuration file.
+class ReloadChannel
+{
+  public:
+    /// @brief Join the channel in @directory, creating it if needed.
+    /// @throws INIException if the socket can't be created.
+    explicit ReloadChannel(std::filesystem::path directory)
+      : m_directory(std::move(directory))
+    {
+        static std::atomic<unsigned> counter{ 0 };
+        std::filesystem::create_directories(m_directory);
+        m_path = m_directory / (std::to_string(::getpid()) + "-" +
+                                std::to_string(counter++) + ".sock");
+
+        // Everything that may throw comes before the socket, which the
+        // destructor of a half constructed channel wouldn't close
+        auto address = posix::make_address(m_path);
+        std::filesystem::remove(m_path);
+        m_fd = posix::socket(SOCK_DGRAM);
+        if (m_fd < 0) {
+            throw posix::error("socket");
+        }
+        if (::bind(m_fd,
+                   reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)) != 0) {
+            ::close(m_fd);
+            throw posix::error("bind " + m_path.string());
+        }
+    };
+
+    ReloadChannel(const ReloadChannel&) = delete;
+    ReloadChannel& operator=(const ReloadChannel&) = delete;
+
+    ~ReloadChannel()
+    {
+        ::close(m_fd);
+        std::error_code ignored;
+        std::filesystem::remove(m_path, ignored);
+    };
+
+    /// @brief File descriptor that becomes readable when a generation was
+    /// broadcast, for use with poll() or an event loop.
+    int fd() const { return m_fd; };
+
+    /// @brief Send @generation to every other member of the channel. Sockets
+    /// left behind by processes that exited are removed.
+    /// @return number of members notified
+    std::size_t broadcast(std::uint64_t generation) const
+    {
+        std::size_t notified = 0;
+        std::error_code ec;
+        for (const auto& entry :
+             std::filesystem::directory_iterator(m_directory, ec)) {
+            const auto& peer = entry.path();
+            if (peer.extension() != ".sock" || peer == m_path) {
+                continue;
+            }
+            auto address = posix::make_address(peer);
+            if (::sendto(m_fd,
+                         &generation,
+                         sizeof(generation),
+                         MSG_DONTWAIT,
+                         reinterpret_cast<const sockaddr*>(&address),
+                         sizeof(address)) == sizeof(generation)) {
+                ++notified;
+            } else if (errno == ECONNREFUSED || errno == ENOENT) {
+                std::filesystem::remove(peer, ec);
+            }
+        }
+        return notified;
+    };
+
+    /// @brief Wait up to @timeout_ms milliseconds (-1 waits forever) for a
+    /// broadcast. All pending broadcasts are consumed at once, so a burst of
+    /// changes results in a single reload.
+    /// @return the generation broadcast last, or nothing on timeout.
+    /// Generations are hashes, not counters, so only the order they arrived
+    /// in tells which is current.
+    std::optional<std::uint64_t> wait(int timeout_ms = 0) const
+    {
+        pollfd request{ m_fd, POLLIN, 0 };
+        if (::poll(&request, 1, timeout_ms) <= 0) {
+            return std::nullopt;
+        }
+        std::optional<std::uint64_t> last;
+        std::uint64_t generation = 0;
+        while (::recv(m_fd, &generation, sizeof(generation), MSG_DONTWAIT) ==
+               sizeof(generation)) {
+            last = generation;
+        }
+        return last;
+    };
+
+  private:
+    std::filesystem::path m_directory;
+    std::filesystem::path m_path;
+    int m_fd = -1;
+};
+
+/// @brief Watches a configuration file for a ReloadChannel. The one process
+/// running the watcher stats the file; everyone else waits on the channel.
+class ReloadWatcher
+{
+  public:
+    ReloadWatcher(std::filesystem::path config, const ReloadChannel& channel)
+      : m_config(std::move(config))
+      , m_channel(channel)
+      , m_generation(config_generation(m_config)){};
+
+    /// @brief Broadcast a new generation if the file changed since the last
+    /// call.
+    /// @return true if a change was broadcast
+    bool check()
+    {
+        std::error_code ec;
+        auto generation = config_generation(m_config, ec);
+        if (ec || generation == m_generation) {
+            return false;
+        }
+        m_generation = generation;
+        m_channel.broadcast(generation);
+        return true;
+    };
+
+    std::uint64_t generation() const { return m_generation; };
+
+  private:
+    std::filesystem::path m_config;
+    const ReloadChannel& m_channel;
+    std::uint64_t m_generation;
+};
+}
+
+#endif
@@ -0,0 +1,556 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Streaming parser behind SimpleINI, for tools that visit a file once
+// without building a configuration.
+
+// Outside the include guard: unless SIMPLEINI_COMPILED is defined,
+// simpleini.h includes this header at its end for its implementation.
+#include "simpleini.h"
+
+#ifndef _SIMPLEINI_PARSER_H
+#define _SIMPLEINI_PARSER_H
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <istream>
+#include <limits>
+
+namespace simpleini {
+
+inline bool
+string_is_valid(std::string_view str)
+{
+    if (str.empty() || str.starts_with(';') || str.starts_with('#') ||
+        str.find_first_not_of(' ') == str.npos) {
+        return false;
+    }
+    return true;
+}
+
+inline std::string_view
+parse_section_value(std::string_view str)
+{
+    std::size_t start = 1;
+    std::size_t end = str.find(']');
+    return str.substr(start, end - 1);
+}
+
+
+inline std::pair<std::string_view, std::string_view>
+parse_key_value(std::string_view str)
+{
+    std::size_t equalpos = str.find('=');
+    std::string_view key = str.substr(0, equalpos);
+    std::string_view value = str.substr(equalpos + 1);
+
+    return { strip(key), strip(value) };
+}
+
+
+/// @brief Remove a comment starting with ';' or '#' after a blank from the
+/// end of @value
+inline std::string_view
+strip_inline_comment(std::string_view value)
+{
+    // Two memchr scans are faster than find_first_of, which tests every
+    // character against the set
+    std::size_t end = value.size();
+    for (char marker : { ';', '#' }) {
+        for (std::size_t pos = value.find(marker); pos < end;
+             pos = value.find(marker, pos + 1)) {
+            if (pos == 0 || value[pos - 1] == ' ' || value[pos - 1] == '\t') {
+                end = pos;
+                break;
+            }
+        }
+    }
+    // Blanks before the marker may be tabs, which strip_trailing keeps
+    value = value.substr(0, end);
+    return value.substr(0, value.find_last_not_of(" \t") + 1);
+}
+
+
+/// @brief Line by line INI parser reporting its input to a visitor.
+/// See parse() for the visitor interface.
+SIMPLEINI_EXPORT template<typename Visitor>
+class INIParser
+{
+  public:
+    explicit INIParser(Visitor& visitor,
+                       const INILimits& limits = {},
+                       const INISyntax& syntax = {})
+      : m_visitor(visitor)
+      , m_limits(limits)
+      , m_syntax(syntax){};
+
+    /// @brief True while the lines of a section rejected by the visitor are
+    /// being skipped. Only section headers need to be passed to feed() then.
+    bool skipping() const { return m_skipping; };
+
+    /// @brief Parse a single line, without its terminating newline. Pass
+    /// false for @newline if the input ended before one. Call finish() after
+    /// the last line. @line must stay valid until the next call to feed() or
+    /// finish(), so a value can be held until it's known not to continue.
+    /// @throws INIException if a limit is exceeded
+    void feed(std::string_view line, bool newline = true)
+    {
+        ++m_line_number;
+        consume(line.size() + (newline ? 1 : 0));
+        if (line.size() > m_limits.max_line_length) {
+            limit_exceeded("is longer than the maximum line length",
+                           m_limits.max_line_length);
+        }
+        if (m_pending && continue_value(line)) {
+            return;
+        }
+        if (m_skipping && !line.starts_with('[')) {
+            return;
+        }
+
+        if (line.starts_with(';') || line.starts_with('#')) {
+            if constexpr (requires { m_visitor.on_comment(line); }) {
+                m_visitor.on_comment(line);
+            }
+        } else if (!string_is_valid(line)) {
+            return;
+        } else if (line.starts_with('[')) {
+            section(parse_section_value(line));
+        } else if (line.find('=') != line.npos) {
+            auto [key, value] = parse_key_value(line);
+            if (m_syntax.backslash_continuation && value.ends_with('\\')) {
+                begin_value(line, key, value);
+            } else if (m_syntax.indented_continuation) {
+                defer_value(line, key, value);
+            } else {
+                key_value(line, key, value);
+            }
+        } else {
+            malformed(line);
+        }
+    }
+
+    /// @brief Report a value still waiting for continuation lines. Call once
+    /// after the last line.
+    void finish()
+    {
+        if (m_pending) {
+            m_pending = false;
+            m_continuing = false;
+            // Blanks before a final backslash don't end the value
+            m_blanks.clear();
+            if (m_discarding) {
+                return;
+            }
+            if (m_deferred) {
+                m_deferred = false;
+                report(m_deferred_key, m_deferred_value);
+            } else {
+                report(m_key, m_value);
+            }
+        }
+    }
+
+    /// @brief Account for @lines lines of @bytes bytes in total passed over
+    /// without calling feed().
+    /// @throws INIException if the input size limit is exceeded
+    void skip(std::size_t lines, std::size_t bytes)
+    {
+        m_line_number += lines;
+        consume(bytes);
+    };
+
+  private:
+    Visitor& m_visitor;
+    INILimits m_limits;
+    INISyntax m_syntax;
+    // Unescaped value of the current line, only used for escaped values
+    std::string m_unescaped;
+    // Value that may continue on the next lines, assembled in place
+    std::string m_key;
+    std::string m_value;
+    // Blanks before the backslash of the last line, added once it continues
+    std::string m_blanks;
+    // Value of the previous line, viewed in place until a continuation line
+    // copies it into m_key and m_value
+    std::string_view m_deferred_key;
+    std::string_view m_deferred_value;
+    bool m_deferred = false;
+    bool m_pending = false;
+    bool m_continuing = false;
+    // The pending value had a malformed line and is dropped
+    bool m_discarding = false;
+    std::size_t m_line_number = 0;
+    std::size_t m_input_bytes = 0;
+    std::size_t m_stored_bytes = 0;
+    std::size_t m_sections = 0;
+    std::size_t m_section_keys = 0;
+    bool m_skipping = false;
+
+    void key_value(std::string_view line,
+                   std::string_view key,
+                   std::string_view value)
+    {
+        if (!read_value(value)) {
+            malformed(line);
+            return;
+        }
+        report(key, value);
+    }
+
+    void report(std::string_view key, std::string_view value)
+    {
+        if (++m_section_keys > m_limits.max_keys_per_section) {
+            limit_exceeded("exceeds the maximum number of keys in a "
+                           "section",
+                           m_limits.max_keys_per_section);
+        }
+        store(key.size() + value.size());
+        if constexpr (requires { m_visitor.on_key_value(key, value); }) {
+            m_visitor.on_key_value(key, value);
+        }
+    }
+
+    void begin_value(std::string_view line,
+                     std::string_view key,
+                     std::string_view value)
+    {
+        m_key.assign(key);
+        m_value.clear();
+        m_pending = true;
+        m_discarding = false;
+        if (!append_value(value)) {
+            malformed(line);
+            m_discarding = true;
+        }
+    }
+
+    /// Hold a value that indented lines may continue without copying it
+    void defer_value(std::string_view line,
+                     std::string_view key,
+                     std::string_view value)
+    {
+        m_pending = true;
+        m_discarding = !read_value(value);
+        if (m_discarding) {
+            malformed(line);
+            return;
+        }
+        m_deferred = true;
+        m_deferred_key = key;
+        m_deferred_value = value;
+    }
+
+    /// Append @line to the pending value if it continues it, otherwise report
+    /// the value. Indented comment lines are skipped like in Python's
+    /// configparser, they don't end the value.
+    /// @return true if @line was consumed
+    bool continue_value(std::string_view line)
+    {
+        std::size_t indent = line.find_first_not_of(" \t");
+        if (!m_continuing &&
+            !(m_syntax.indented_continuation && indent != 0 &&
+              indent != line.npos)) {
+            finish();
+            return false;
+        }
+        std::string_view value =
+          indent == line.npos ? std::string_view{} : line.substr(indent);
+        value = value.substr(0, value.find_last_not_of(" \t") + 1);
+        if (!m_continuing &&
+            (value.starts_with(';') || value.starts_with('#'))) {
+            if constexpr (requires { m_visitor.on_comment(value); }) {
+                m_visitor.on_comment(value);
+            }
+            return true;
+        }
+        if (m_deferred) {
+            // Copy before reading the line, which may reuse m_unescaped
+            m_deferred = false;
+            m_key.assign(m_deferred_key);
+            m_value.assign(m_deferred_value);
+        }
+        if (m_discarding) {
+            m_continuing =
+              m_syntax.backslash_continuation && value.ends_with('\\');
+            return true;
+        }
+        if (!m_continuing) {
+            m_value += '\n';
+        }
+        if (!append_value(value)) {
+            malformed(line);
+            m_discarding = true;
+        }
+        return true;
+    }
+
+    /// Append one line of a value to m_value, stripping its comment and
+    /// quotes on their own so they don't hide the lines after them.
+    /// @return false if the line is malformed
+    bool append_value(std::string_view value)
+    {
+        m_continuing =
+          m_syntax.backslash_continuation && value.ends_with('\\');
+        std::string_view blanks;
+        if (m_continuing) {
+            value.remove_suffix(1);
+            std::string_view text =
+              value.substr(0, value.find_last_not_of(" \t") + 1);
+            blanks = value.substr(text.size());
+            value = text;
+        }
+        if (!read_value(value)) {
+            return false;
+        }
+        // Blanks kept before a backslash join words
+        m_value += m_blanks;
+        m_value += value;
+        m_blanks.assign(blanks);
+        return true;
+    }
+
+    void malformed(std::string_view line)
+    {
+        if constexpr (requires { m_visitor.on_error(line, 0); }) {
+            m_visitor.on_error(line, m_line_number);
+        } else {
+            throw INIException{ "Failure when parsing line " +
+                                std::string(line) };
+        }
+    }
+
+    /// Apply the enabled syntax extensions to @value. Plain values stay views
+    /// into the line; only escaped values are copied, into m_unescaped.
+    /// @return false if @value is malformed
+    bool read_value(std::string_view& value)
+    {
+        if (m_syntax.quoted_values &&
+            (value.starts_with('"') || value.starts_with('\''))) {
+            return unquote(value);
+        }
+        if (m_syntax.inline_comments) {
+            value = strip_inline_comment(value);
+        }
+        return true;
+    }
+
+    bool unquote(std::string_view& value)
+    {
+        const char quote = value.front();
+        std::size_t end = 1;
+        bool escaped = false;
+        while (end < value.size() && value[end] != quote) {
+            if (value[end] == '\\' && quote == '"') {
+                escaped = true;
+                ++end;
+            }
+            ++end;
+        }
+        if (end >= value.size()) {
+            return false;
+        }
+        std::string_view rest = strip_leading(value.substr(end + 1));
+        if (!rest.empty() && !(m_syntax.inline_comments &&
+                               strip_inline_comment(rest).empty())) {
+            return false;
+        }
+        value = value.substr(1, end - 1);
+        if (!escaped) {
+            return true;
+        }
+
+        m_unescaped.clear();
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (value[i] != '\\') {
+                m_unescaped.push_back(value[i]);
+                continue;
+            }
+            switch (value[++i]) {
+                case 'n':
+                    m_unescaped.push_back('\n');
+                    break;
+                case 't':
+                    m_unescaped.push_back('\t');
+                    break;
+                case 'r':
+                    m_unescaped.push_back('\r');
+                    break;
+                case '0':
+                    m_unescaped.push_back('\0');
+                    break;
+                case '\\':
+                case '"':
+                case '\'':
+                case ';':
+                case '#':
+                    m_unescaped.push_back(value[i]);
+                    break;
+                default:
+                    return false;
+            }
+        }
+        value = m_unescaped;
+        return true;
+    }
+
+    void section(std::string_view name)
+    {
+        if (++m_sections > m_limits.max_sections) {
+            limit_exceeded("exceeds the maximum number of sections",
+                           m_limits.max_sections);
+        }
+        m_section_keys = 0;
+        store(name.size());
+        if constexpr (requires {
+                          { m_visitor.on_section(name) } -> std::same_as<bool>;
+                      }) {
+            m_skipping = !m_visitor.on_section(name);
+        } else if constexpr (requires { m_visitor.on_section(name); }) {
+            m_visitor.on_section(name);
+        }
+    }
+
+    void consume(std::size_t bytes)
+    {
+        m_input_bytes += bytes;
+        if (m_input_bytes > m_limits.max_file_size) {
+            limit_exceeded("exceeds the maximum input size",
+                           m_limits.max_file_size);
+        }
+    }
+
+    void store(std::size_t bytes)
+    {
+        m_stored_bytes += bytes;
+        if (m_stored_bytes > m_limits.max_total_bytes) {
+            limit_exceeded("exceeds the maximum total size",
+                           m_limits.max_total_bytes);
+        }
+    }
+
+    [[noreturn]] void limit_exceeded(const std::string& what,
+                                     std::size_t limit) const
+    {
+        throw INIException("Line " + std::to_string(m_line_number) + " " +
+                           what + " of " + std::to_string(limit));
+    }
+};
+
+/// @brief std::getline that stops once @line is longer than @max_length, so
+/// an overlong line is never buffered in full.
+inline bool
+getline_bounded(std::istream& input, std::string& line, std::size_t max_length)
+{
+    if (max_length == INILimits::unlimited) {
+        return static_cast<bool>(std::getline(input, line));
+    }
+    using traits = std::istream::traits_type;
+    line.clear();
+    std::istream::sentry sentry(input, true);
+    if (!sentry) {
+        return false;
+    }
+    auto* buffer = input.rdbuf();
+    while (line.size() <= max_length) {
+        auto c = buffer->sbumpc();
+        if (traits::eq_int_type(c, traits::eof())) {
+            input.setstate(line.empty() ? std::ios::eofbit | std::ios::failbit
+                                        : std::ios::eofbit);
+            return !line.empty();
+        }
+        if (traits::to_char_type(c) == '\n') {
+            return true;
+        }
+        line.push_back(traits::to_char_type(c));
+    }
+    return true;
+}
+
+/// @brief Parse INI formatted @text without building a SimpleINI.
+/// Every line is reported to @visitor, which may define any of
+///   on_section(std::string_view name)
+///   on_key_value(std::string_view key, std::string_view value)
+///   on_comment(std::string_view line)
+///   on_error(std::string_view line, std::size_t line_number)
+/// If on_section returns bool, returning false skips the lines of that
+/// section with a scan for the next section header. Values are reported
+/// after applying the extensions enabled in @syntax.
+/// The views are only valid for the duration of the call.
+/// @throws INIException on a malformed line if the visitor has no on_error,
+/// or if one of @limits is exceeded.
+SIMPLEINI_EXPORT template<typename Visitor>
+void
+parse(std::string_view text,
+      Visitor&& visitor,
+      const INILimits& limits = {},
+      const INISyntax& syntax = {})
+{
+    INIParser parser(visitor, limits, syntax);
+    while (!text.empty()) {
+        if (parser.skipping() && !text.starts_with('[')) {
+            std::size_t header = text.find("\n[");
+            std::size_t end = header == text.npos ? text.size() : header + 1;
+            parser.skip(static_cast<std::size_t>(std::count(
+                          text.begin(), text.begin() + end, '\n')),
+                        end);
+            text.remove_prefix(end);
+            continue;
+        }
+        std::size_t newline = text.find('\n');
+        parser.feed(text.substr(0, newline), newline != text.npos);
+        text.remove_prefix(newline == text.npos ? text.size() : newline + 1);
+    }
+    parser.finish();
+}
+
+/// @brief Parse INI formatted data from @input line by line. Memory use is
+/// bounded by the longest line. See parse(std::string_view, Visitor&&).
+SIMPLEINI_EXPORT template<typename Visitor>
+void
+parse(std::istream& input,
+      Visitor&& visitor,
+      const INILimits& limits = {},
+      const INISyntax& syntax = {})
+{
+    INIParser parser(visitor, limits, syntax);
+    // Alternate buffers, the parser may still view the previous line
+    std::array<std::string, 2> lines;
+    std::size_t current = 0;
+    while (input) {
+        if (parser.skipping() && input.peek() != '[') {
+            input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            parser.skip(1, static_cast<std::size_t>(input.gcount()));
+            continue;
+        }
+        std::string& line = lines[current];
+        if (getline_bounded(input, line, limits.max_line_length)) {
+            parser.feed(line, !input.eof());
+            current ^= 1;
+        }
+    }
+    parser.finish();
+}
+}
+
+#endif
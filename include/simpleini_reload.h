@@ -0,0 +1,207 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_RELOAD_H
+#define _SIMPLEINI_RELOAD_H
+
+#include <cstdint>
+#include <functional>
+
+#include "simpleini.h"
+
+namespace simpleini {
+
+/// @brief A single key changed by ReloadableINI::reload(). A value missing
+/// before or after the reload is nullptr. Only valid during the callback.
+SIMPLEINI_EXPORT struct INIChange
+{
+    std::string_view section;
+    std::string_view key;
+    const std::string* old_value;
+    const std::string* new_value;
+};
+
+/// @brief Configuration file that can be reloaded, notifying subscribers of
+/// the keys that changed. Reloading computes the change set once and only
+/// calls the subscribers matching a changed key, so its cost depends on the
+/// number of changes, not on the number of subscribers.
+/// Not thread safe. Callbacks must not subscribe or unsubscribe.
+SIMPLEINI_EXPORT class ReloadableINI
+{
+  public:
+    using callback = std::function<void(const INIChange&)>;
+    using subscription = std::uint64_t;
+
+    /// @brief Load the configuration file at @path
+    /// @throws INIException if the file isn't in valid .ini format.
+    explicit ReloadableINI(std::filesystem::path path, INIOptions options = {})
+      : m_config(std::move(path), std::move(options))
+      , m_keys(less())
+      , m_sections(less())
+      , m_prefixes(less()){};
+
+    /// @brief The currently loaded configuration
+    const SimpleINI& config() const { return m_config; };
+
+    /// @brief Call @on_change when @key in section @section changes
+    subscription subscribe(const std::string& section,
+                           std::string key,
+                           callback on_change)
+    {
+        auto& keys = m_keys.try_emplace(section, less()).first->second;
+        keys[std::move(key)].push_back({ ++m_last_id, std::move(on_change) });
+        return m_last_id;
+    };
+
+    /// @brief Call @on_change for every changed key of section @section
+    subscription subscribe_section(std::string section, callback on_change)
+    {
+        m_sections[std::move(section)].push_back(
+          { ++m_last_id, std::move(on_change) });
+        return m_last_id;
+    };
+
+    /// @brief Call @on_change for every changed key of the sections whose
+    /// name starts with @prefix
+    subscription subscribe_prefix(std::string prefix, callback on_change)
+    {
+        m_prefixes[std::move(prefix)].push_back(
+          { ++m_last_id, std::move(on_change) });
+        return m_last_id;
+    };
+
+    /// @brief Remove subscription @id
+    void unsubscribe(subscription id)
+    {
+        auto erase = [id](auto& subscribers) {
+            for (auto it = subscribers.begin(); it != subscribers.end();) {
+                std::erase_if(it->second,
+                              [id](const auto& sub) { return sub.id == id; });
+                it = it->second.empty() ? subscribers.erase(it) : ++it;
+            }
+        };
+        for (auto it = m_keys.begin(); it != m_keys.end();) {
+            erase(it->second);
+            it = it->second.empty() ? m_keys.erase(it) : ++it;
+        }
+        erase(m_sections);
+        erase(m_prefixes);
+    };
+
+    /// @brief Read the configuration file again and notify the subscribers
+    /// of every changed key.
+    /// @return number of changed keys
+    /// @throws INIException if the file isn't in valid .ini format, in which
+    /// case the previous configuration is kept.
+    std::size_t reload()
+    {
+        SimpleINI previous(m_config.get_config_path(), m_config.get_options());
+        // previous holds the old configuration from here on
+        std::swap(previous, m_config);
+
+        std::size_t changes = 0;
+        std::string_view current_section;
+        bool first = true;
+        std::vector<const std::vector<entry>*> section_subscribers;
+        const std::map<std::string, std::vector<entry>, key_less>* keys =
+          nullptr;
+
+        diff(previous,
+             m_config,
+             [&](std::string_view section,
+                 std::string_view key,
+                 const std::string* old_value,
+                 const std::string* new_value) {
+                 if (first || section != current_section) {
+                     first = false;
+                     current_section = section;
+                     section_subscribers = subscribers_of(section);
+                     auto it = m_keys.find(section);
+                     keys = it == m_keys.end() ? nullptr : &it->second;
+                 }
+                 ++changes;
+                 const INIChange change{ section, key, old_value, new_value };
+                 if (keys) {
+                     auto it = keys->find(key);
+                     if (it != keys->end()) {
+                         notify(it->second, change);
+                     }
+                 }
+                 for (const auto* subscribers : section_subscribers) {
+                     notify(*subscribers, change);
+                 }
+             });
+        return changes;
+    };
+
+  private:
+    struct entry
+    {
+        subscription id;
+        callback on_change;
+    };
+
+    SimpleINI m_config;
+    subscription m_last_id = 0;
+    std::map<std::string,
+             std::map<std::string, std::vector<entry>, key_less>,
+             key_less>
+      m_keys;
+    std::map<std::string, std::vector<entry>, key_less> m_sections;
+    std::map<std::string, std::vector<entry>, key_less> m_prefixes;
+
+    key_less less() const
+    {
+        return key_less{ m_config.get_options().case_insensitive };
+    };
+
+    /// Section and prefix subscribers interested in section @section.
+    std::vector<const std::vector<entry>*> subscribers_of(
+      std::string_view section) const
+    {
+        std::vector<const std::vector<entry>*> found;
+        auto it = m_sections.find(section);
+        if (it != m_sections.end()) {
+            found.push_back(&it->second);
+        }
+        if (!m_prefixes.empty()) {
+            for (std::size_t length = 0; length <= section.size(); ++length) {
+                auto prefix = m_prefixes.find(section.substr(0, length));
+                if (prefix != m_prefixes.end()) {
+                    found.push_back(&prefix->second);
+                }
+            }
+        }
+        return found;
+    };
+
+    static void notify(const std::vector<entry>& subscribers,
+                       const INIChange& change)
+    {
+        for (const auto& sub : subscribers) {
+            sub.on_change(change);
+        }
+    };
+};
+}
+
+#endif
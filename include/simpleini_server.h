@@ -0,0 +1,603 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_SERVER_H
+#define _SIMPLEINI_SERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "simpleini_notify.h"
+#include "simpleini_reload.h"
+
+namespace simpleini {
+
+/// @brief A lookup sent to an INIServer
+struct INIQuery
+{
+    enum class kind : std::uint8_t
+    {
+        get = 1,     ///< value of key in section
+        section = 2, ///< all keys of section
+        prefix = 3,  ///< all keys of the sections starting with section
+    };
+
+    kind op;
+    std::string section;
+    std::string key;
+};
+
+/// @brief A key value pair returned by an INIServer
+struct INIEntry
+{
+    std::string section;
+    std::string key;
+    std::string value;
+};
+
+/// @brief Result of a single INIQuery, empty if nothing was found
+using INIQueryResult = std::optional<std::vector<INIEntry>>;
+
+/// Framing shared by INIServer and INIClient. A request is a u32 size
+/// followed by that many bytes: a u32 query count and (u8 kind, string
+/// section, string key) per query. A response is a u8 of flags and a u32
+/// result count followed by (u8 found, u32 entry count, entries) per result,
+/// each entry being three strings. Strings are a u32 length followed by the bytes. Integers use host
+/// byte order, both ends are local.
+namespace wire {
+
+/// Response flag: the server matches names ignoring ASCII case, see
+/// INIOptions::case_insensitive
+constexpr std::uint8_t case_insensitive = 1;
+
+/// Largest request the server accepts, which also bounds its strings
+constexpr std::uint32_t max_request_size = 1 << 20;
+
+/// Most queries the server accepts in one request
+constexpr std::uint32_t max_queries = 1 << 16;
+
+/// Response bytes after which the server answers no further queries of a
+/// client, but closes its connection. Bounds the memory and time one read
+/// from a client can take, since many prefix queries may each return the
+/// whole configuration.
+constexpr std::size_t max_response_size = 1 << 24;
+
+inline bool
+write_all(int fd, const void* data, std::size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::send(fd, bytes, size, posix::send_flags);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+inline bool
+read_all(int fd, void* data, std::size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = ::recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+inline void
+put_u32(std::string& buffer, std::uint32_t value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void
+put_string(std::string& buffer, std::string_view str)
+{
+    put_u32(buffer, static_cast<std::uint32_t>(str.size()));
+    buffer.append(str);
+}
+
+inline bool
+get_u32(int fd, std::uint32_t& value)
+{
+    return read_all(fd, &value, sizeof(value));
+}
+
+inline bool
+get_string(int fd, std::string& str)
+{
+    std::uint32_t size = 0;
+    if (!get_u32(fd, size)) {
+        return false;
+    }
+    str.resize(size);
+    return read_all(fd, str.data(), size);
+}
+
+/// Reads a buffered request, failing instead of reading past its end
+struct reader
+{
+    std::string_view data;
+
+    bool get(void* value, std::size_t size)
+    {
+        if (data.size() < size) {
+            return false;
+        }
+        std::memcpy(value, data.data(), size);
+        data.remove_prefix(size);
+        return true;
+    }
+
+    bool get_string(std::string& str)
+    {
+        std::uint32_t size = 0;
+        if (!get(&size, sizeof(size)) || data.size() < size) {
+            return false;
+        }
+        str.assign(data.substr(0, size));
+        data.remove_prefix(size);
+        return true;
+    }
+};
+}
+
+/// @brief Serves lookups into a configuration file over a Unix domain socket
+/// (POSIX only). The file is parsed once and reloaded when it changes, so
+/// short lived clients don't have to parse it themselves.
+class INIServer
+{
+  public:
+    /// @brief Load @config and listen on @socket_path
+    /// @throws INIException if the file can't be loaded or the socket can't
+    /// be created.
+    INIServer(std::filesystem::path socket_path,
+              std::filesystem::path config,
+              INIOptions options = {})
+      : m_socket_path(std::move(socket_path))
+      , m_config_path(std::move(config))
+      , m_config(m_config_path, std::move(options))
+      , m_generation(config_generation(m_config_path))
+    {
+        // Throws before the socket exists, see ReloadChannel
+        auto address = posix::make_address(m_socket_path);
+        std::filesystem::remove(m_socket_path);
+        m_fd = posix::socket(SOCK_STREAM);
+        if (m_fd < 0) {
+            throw posix::error("socket");
+        }
+        if (::bind(m_fd,
+                   reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)) != 0 ||
+            ::listen(m_fd, SOMAXCONN) != 0) {
+            ::close(m_fd);
+            throw posix::error("listen " + m_socket_path.string());
+        }
+    };
+
+    INIServer(const INIServer&) = delete;
+    INIServer& operator=(const INIServer&) = delete;
+
+    ~INIServer()
+    {
+        for (const auto& client : m_clients) {
+            ::close(client.fd);
+        }
+        ::close(m_fd);
+        std::error_code ignored;
+        std::filesystem::remove(m_socket_path, ignored);
+    };
+
+    /// @brief Serve clients until stop() is called. The configuration file
+    /// is checked for changes every @check_interval_ms milliseconds.
+    void run(int check_interval_ms = 100)
+    {
+        m_running = true;
+        while (m_running) {
+            serve(check_interval_ms);
+        }
+    };
+
+    /// @brief Make run() return. Safe to call from other threads and signal
+    /// handlers.
+    void stop() { m_running = false; };
+
+    /// @brief Wait up to @timeout_ms for requests and answer them, then
+    /// reload the configuration file if it changed. Clients are served
+    /// without blocking, so one stalled client doesn't hold up the others.
+    void serve(int timeout_ms)
+    {
+        std::vector<pollfd> fds{ { m_fd, POLLIN, 0 } };
+        for (const auto& client : m_clients) {
+            // Read no further requests until the responses are sent, so a
+            // client that doesn't read can't make the server buffer more
+            short events = client.output.empty() ? POLLIN : POLLOUT;
+            fds.push_back({ client.fd, events, 0 });
+        }
+        if (::poll(fds.data(), fds.size(), timeout_ms) > 0) {
+            for (std::size_t i = 1; i < fds.size(); ++i) {
+                if (fds[i].revents != 0 && !service(m_clients[i - 1])) {
+                    ::close(fds[i].fd);
+                    m_clients[i - 1].fd = -1;
+                }
+            }
+            std::erase_if(m_clients,
+                          [](const auto& client) { return client.fd < 0; });
+            if (fds[0].revents & POLLIN) {
+                int client = posix::accept(m_fd);
+                if (client >= 0) {
+                    m_clients.push_back({ client, {}, {} });
+                }
+            }
+        }
+        reload_if_changed();
+    };
+
+    /// @brief The configuration being served
+    const SimpleINI& config() const { return m_config.config(); };
+
+  private:
+    struct client
+    {
+        int fd;
+        std::string input;  ///< received bytes of incomplete requests
+        std::string output; ///< responses not sent yet
+    };
+
+    std::filesystem::path m_socket_path;
+    std::filesystem::path m_config_path;
+    ReloadableINI m_config;
+    std::uint64_t m_generation;
+    int m_fd = -1;
+    std::vector<client> m_clients;
+    std::atomic<bool> m_running = false;
+
+    void reload_if_changed()
+    {
+        std::error_code ec;
+        auto generation = config_generation(m_config_path, ec);
+        if (ec || generation == m_generation) {
+            return;
+        }
+        try {
+            m_config.reload();
+            m_generation = generation;
+        } catch (const INIException&) {
+            // Keep serving the previous configuration until the file is valid
+        }
+    };
+
+    /// Read what @client sent, answer its complete requests and send as
+    /// much of the responses as the socket takes. Returns false if the
+    /// client is gone or sent an invalid request.
+    bool service(client& client)
+    {
+        if (client.output.empty()) {
+            char chunk[16384];
+            ssize_t received = ::recv(client.fd, chunk, sizeof(chunk), 0);
+            if (received < 0) {
+                return errno == EINTR || errno == EAGAIN ||
+                       errno == EWOULDBLOCK;
+            }
+            if (received == 0) {
+                return false;
+            }
+            client.input.append(chunk, static_cast<std::size_t>(received));
+            if (!answer(client)) {
+                return false;
+            }
+        }
+
+        std::size_t sent = 0;
+        while (sent < client.output.size()) {
+            ssize_t written = ::send(client.fd,
+                                     client.output.data() + sent,
+                                     client.output.size() - sent,
+                                     posix::send_flags);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                client.output.erase(0, sent);
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            sent += static_cast<std::size_t>(written);
+        }
+        client.output.clear();
+        return true;
+    };
+
+    /// Answer the complete requests buffered for @client. Returns false if
+    /// a request is malformed or exceeds the limits of wire, including
+    /// responses growing past wire::max_response_size.
+    bool answer(client& client)
+    {
+        std::string_view pending = client.input;
+        std::uint32_t size = 0;
+        while (pending.size() >= sizeof(size)) {
+            std::memcpy(&size, pending.data(), sizeof(size));
+            if (size > wire::max_request_size) {
+                return false;
+            }
+            if (pending.size() - sizeof(size) < size) {
+                break;
+            }
+            wire::reader request{ pending.substr(sizeof(size), size) };
+            pending.remove_prefix(sizeof(size) + size);
+
+            std::uint32_t count = 0;
+            if (!request.get(&count, sizeof(count)) ||
+                count > wire::max_queries) {
+                return false;
+            }
+            client.output.push_back(
+              static_cast<char>(config().get_options().case_insensitive
+                                  ? wire::case_insensitive
+                                  : 0));
+            wire::put_u32(client.output, count);
+            INIQuery query;
+            for (std::uint32_t i = 0; i < count; ++i) {
+                std::uint8_t op = 0;
+                if (!request.get(&op, sizeof(op)) ||
+                    !request.get_string(query.section) ||
+                    !request.get_string(query.key) ||
+                    op < static_cast<std::uint8_t>(INIQuery::kind::get) ||
+                    op > static_cast<std::uint8_t>(INIQuery::kind::prefix) ||
+                    client.output.size() > wire::max_response_size) {
+                    return false;
+                }
+                query.op = static_cast<INIQuery::kind>(op);
+                lookup(query, client.output);
+            }
+        }
+        client.input.erase(0, client.input.size() - pending.size());
+        return true;
+    };
+
+    void lookup(const INIQuery& query, std::string& response) const
+    {
+        const SimpleINI& config = m_config.config();
+        std::string entries;
+        std::uint32_t entry_count = 0;
+        bool ok = false;
+        auto put = [&](std::string_view section,
+                       std::string_view key,
+                       std::string_view value) {
+            wire::put_string(entries, section);
+            wire::put_string(entries, key);
+            wire::put_string(entries, value);
+            ++entry_count;
+        };
+
+        if (query.op == INIQuery::kind::prefix) {
+            const key_less less{ config.get_options().case_insensitive };
+            auto put_section = [&](const auto& entry) {
+                for (const auto& [key, value] : entry.second) {
+                    put(entry.first, key, value);
+                }
+                ok = true;
+            };
+            if (config.get_options().preserve_order) {
+                // Sections in source order aren't grouped by prefix
+                for (const auto& entry : config) {
+                    if (less.is_prefix(query.section, entry.first)) {
+                        put_section(entry);
+                    }
+                }
+            } else {
+                for (auto it = config.lower_bound(query.section);
+                     it != config.end() &&
+                     less.is_prefix(query.section, it->first);
+                     ++it) {
+                    put_section(*it);
+                }
+            }
+        } else if (const auto* section = config.find(query.section)) {
+            if (query.op == INIQuery::kind::section) {
+                for (const auto& [key, value] : *section) {
+                    put(section->name(), key, value);
+                }
+                ok = true;
+            } else if (const auto* value = section->find(query.key)) {
+                put(section->name(), query.key, *value);
+                ok = true;
+            }
+        }
+
+        response.push_back(ok ? 1 : 0);
+        wire::put_u32(response, ok ? entry_count : 0);
+        if (ok) {
+            response += entries;
+        }
+    };
+};
+
+/// @brief Client for an INIServer. Lookups mirror SimpleINI and INISection,
+/// and query() sends many lookups in a single round trip.
+class INIClient
+{
+  public:
+    /// @brief Connect to the INIServer listening on @socket_path
+    /// @throws INIException if the connection fails
+    explicit INIClient(const std::filesystem::path& socket_path)
+    {
+        auto address = posix::make_address(socket_path);
+        m_fd = posix::socket(SOCK_STREAM);
+        if (m_fd < 0) {
+            throw posix::error("socket");
+        }
+        if (::connect(m_fd,
+                      reinterpret_cast<const sockaddr*>(&address),
+                      sizeof(address)) != 0) {
+            ::close(m_fd);
+            throw posix::error("connect " + socket_path.string());
+        }
+    };
+
+    INIClient(const INIClient&) = delete;
+    INIClient& operator=(const INIClient&) = delete;
+
+    ~INIClient() { ::close(m_fd); };
+
+    /// @brief Answer all @queries in one round trip
+    /// @throws INIException if the connection fails or the request exceeds
+    /// the size or query count the server accepts. The server closes the
+    /// connection once the responses exceed wire::max_response_size.
+    std::vector<INIQueryResult> query(const std::vector<INIQuery>& queries)
+    {
+        std::string request;
+        wire::put_u32(request, 0); // size, known once the request is built
+        wire::put_u32(request, static_cast<std::uint32_t>(queries.size()));
+        for (const auto& query : queries) {
+            request.push_back(static_cast<char>(query.op));
+            wire::put_string(request, query.section);
+            wire::put_string(request, query.key);
+        }
+        std::size_t size = request.size() - sizeof(std::uint32_t);
+        if (queries.size() > wire::max_queries ||
+            size > wire::max_request_size) {
+            throw INIException("Request of " + std::to_string(queries.size()) +
+                               " queries and " + std::to_string(size) +
+                               " bytes exceeds the server limits");
+        }
+        auto framed = static_cast<std::uint32_t>(size);
+        std::memcpy(request.data(), &framed, sizeof(framed));
+        if (!wire::write_all(m_fd, request.data(), request.size())) {
+            throw posix::error("send");
+        }
+
+        std::uint8_t flags = 0;
+        std::uint32_t count = 0;
+        if (!wire::read_all(m_fd, &flags, sizeof(flags)) ||
+            !wire::get_u32(m_fd, count)) {
+            throw posix::error("recv");
+        }
+        m_options.case_insensitive = flags & wire::case_insensitive;
+        std::vector<INIQueryResult> results(count);
+        for (auto& result : results) {
+            std::uint8_t found = 0;
+            std::uint32_t entries = 0;
+            if (!wire::read_all(m_fd, &found, sizeof(found)) ||
+                !wire::get_u32(m_fd, entries)) {
+                throw posix::error("recv");
+            }
+            if (!found) {
+                continue;
+            }
+            result.emplace(entries);
+            for (auto& entry : *result) {
+                if (!wire::get_string(m_fd, entry.section) ||
+                    !wire::get_string(m_fd, entry.key) ||
+                    !wire::get_string(m_fd, entry.value)) {
+                    throw posix::error("recv");
+                }
+            }
+        }
+        return results;
+    };
+
+    /// @brief Return value of @key in section @section
+    /// @throws std::out_of_range if the section or key doesn't exist
+    std::string get(std::string_view section, std::string_view key)
+    {
+        auto result = single(
+          { INIQuery::kind::get, std::string(section), std::string(key) });
+        if (!result) {
+            throw std::out_of_range("No key '" + std::string(key) +
+                                    "' in section '" + std::string(section) +
+                                    "'");
+        }
+        return std::move(result->front().value);
+    };
+
+    /// @brief Return a copy of section @section, matching keys like the
+    /// server does
+    /// @throws std::out_of_range if the section doesn't exist
+    INISection section(std::string_view section)
+    {
+        auto result =
+          single({ INIQuery::kind::section, std::string(section), {} });
+        if (!result) {
+            throw std::out_of_range("No section '" + std::string(section) +
+                                    "'");
+        }
+        key_map content(key_less{ m_options.case_insensitive });
+        for (auto& entry : *result) {
+            content.emplace(std::move(entry.key), std::move(entry.value));
+        }
+        // Entries carry the name as the server spells it
+        std::string name = result->empty() ? std::string(section)
+                                           : std::move(result->front().section);
+        return INISection(std::move(name), std::move(content), m_options);
+    };
+
+    /// @brief Return every section whose name starts with @prefix. The
+    /// server matches the prefix, and the result matches names like it does.
+    SimpleINI prefix(std::string_view prefix)
+    {
+        auto result =
+          single({ INIQuery::kind::prefix, std::string(prefix), {} });
+        SimpleINI config(m_options);
+        if (result) {
+            for (auto& entry : *result) {
+                config.set(entry.section,
+                           std::move(entry.key),
+                           std::move(entry.value));
+            }
+        }
+        return config;
+    };
+
+  private:
+    int m_fd = -1;
+    // Name matching of the server, as of its last response
+    INIOptions m_options;
+
+    INIQueryResult single(INIQuery request)
+    {
+        return std::move(query({ std::move(request) }).front());
+    };
+};
+}
+
+#endif
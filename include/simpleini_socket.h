@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_SOCKET_H
+#define _SIMPLEINI_SOCKET_H
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "simpleini.h"
+
+namespace simpleini {
+
+/// Unix domain socket helpers shared by ReloadChannel and INIServer (POSIX
+/// only).
+namespace posix {
+
+/// Address of the socket at @path
+/// @throws INIException if the path doesn't fit into sockaddr_un
+inline sockaddr_un
+make_address(const std::filesystem::path& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string& name = path.native();
+    if (name.size() >= sizeof(address.sun_path)) {
+        throw INIException("Socket path too long: " + name);
+    }
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+    return address;
+}
+
+/// Exception describing the failure of @what from errno
+inline INIException
+error(const std::string& what)
+{
+    return INIException(what + ": " + std::strerror(errno));
+}
+
+#ifdef MSG_NOSIGNAL
+/// Flags for send() that keep a closed peer from raising SIGPIPE
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+/// Flags for send(); without MSG_NOSIGNAL, socket() and accept() set
+/// SO_NOSIGPIPE instead
+constexpr int send_flags = 0;
+#endif
+
+/// Set close-on-exec on @fd, and O_NONBLOCK if @nonblocking. Closes @fd on
+/// failure.
+/// @return @fd, or -1 on failure
+inline int
+set_flags(int fd, bool nonblocking)
+{
+    if (fd < 0) {
+        return fd;
+    }
+    int flags = ::fcntl(fd, F_GETFL);
+    bool failed = ::fcntl(fd, F_SETFD, FD_CLOEXEC) != 0 || flags < 0 ||
+                  (nonblocking &&
+                   ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    failed = failed ||
+             ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on)) != 0;
+#endif
+    if (failed) {
+        // Report the fcntl error, not one of close
+        int failure = errno;
+        ::close(fd);
+        errno = failure;
+        return -1;
+    }
+    return fd;
+}
+
+/// Unix domain socket of @type that isn't inherited by child processes.
+/// SOCK_CLOEXEC isn't available everywhere, so this sets the flag with
+/// fcntl, which leaves a window for a fork in another thread.
+/// @return the descriptor, or -1 with errno set
+inline int
+socket(int type)
+{
+    return set_flags(::socket(AF_UNIX, type, 0), false);
+}
+
+/// Accept a connection on @fd as a non-blocking descriptor that isn't
+/// inherited by child processes
+/// @return the descriptor, or -1 with errno set
+inline int
+accept(int fd)
+{
+    return set_flags(::accept(fd, nullptr, nullptr), true);
+}
+}
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Sharing of identical section contents between configurations, see
+// INIOptions::section_store.
+
+// Before the include guard, like in simpleini_parser.h.
+#include "simpleini.h"
+
+#ifndef _SIMPLEINI_STORE_H
+#define _SIMPLEINI_STORE_H
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace simpleini {
+
+/// @brief Content-addressed store of section contents. Sections interned in
+/// the same store share one immutable copy of identical contents; a shared
+/// section is copied again when it is modified. Set INIOptions::section_store
+/// to intern every section of a loaded file. The store only tracks contents
+/// still in use by some section.
+SIMPLEINI_EXPORT class INISectionStore
+{
+  public:
+    /// @brief Make @section share the contents of an identical section
+    /// interned before, or publish its contents for later sections.
+    void intern(INISection& section)
+    {
+        if (!section.m_body || section.m_body->contents.empty()) {
+            return;
+        }
+        const auto& contents = section.m_body->contents;
+        std::size_t hash = hash_contents(contents);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [first, last] = m_bodies.equal_range(hash);
+        for (auto it = first; it != last; ++it) {
+            auto shared = it->second.lock();
+            if (shared && shared != section.m_body &&
+                shared->contents.key_comp().case_insensitive ==
+                  contents.key_comp().case_insensitive &&
+                shared->contents.ordered() == contents.ordered() &&
+                // A body without decoded values would lose ours
+                shared->typed.empty() == section.m_body->typed.empty() &&
+                std::equal(shared->contents.begin(),
+                           shared->contents.end(),
+                           contents.begin(),
+                           contents.end())) {
+                section.m_body = std::move(shared);
+                return;
+            }
+        }
+        if (section.m_body->interned) {
+            return;
+        }
+        // Published bodies are never modified in place
+        section.m_body->interned = true;
+        m_bodies.emplace(hash, section.m_body);
+        if (m_bodies.size() >= m_sweep_at) {
+            std::erase_if(m_bodies, [](const auto& entry) {
+                return entry.second.expired();
+            });
+            m_sweep_at = std::max<std::size_t>(64, m_bodies.size() * 2);
+        }
+    }
+
+    /// @brief Number of distinct section contents in use
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<std::size_t>(std::count_if(
+          m_bodies.begin(), m_bodies.end(), [](const auto& entry) {
+              return !entry.second.expired();
+          }));
+    }
+
+  private:
+    static std::size_t hash_contents(const name_table<std::string>& contents)
+    {
+        std::uint64_t hash = 14695981039346656037ULL;
+        auto add = [&hash](std::string_view str, char separator) {
+            for (char c : str) {
+                hash =
+                  (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+            hash = (hash ^ static_cast<unsigned char>(separator)) *
+                   1099511628211ULL;
+        };
+        for (const auto& [key, value] : contents) {
+            add(key, '=');
+            add(value, '\n');
+        }
+        return static_cast<std::size_t>(hash);
+    }
+
+    mutable std::mutex m_mutex;
+    std::unordered_multimap<std::size_t, std::weak_ptr<INISection::body>>
+      m_bodies;
+    std::size_t m_sweep_at = 64;
+};
+}
+
+#endif
@@ -0,0 +1,553 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef _SIMPLEINI_VERSIONED_H
+#define _SIMPLEINI_VERSIONED_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "simpleini.h"
+
+namespace simpleini {
+
+/// @brief Immutable map of names sorted by key_less. set() returns a new
+/// map sharing everything with this one except the O(log n) nodes on the
+/// path to the name, so every version of the map stays valid and cheap to
+/// keep. The nodes form an AVL tree.
+template<typename T>
+class persistent_map
+{
+  public:
+    using value_type = std::pair<const std::string, T>;
+
+  private:
+    struct node
+    {
+        value_type entry;
+        // Position in insertion order, kept when the value is replaced
+        std::uint64_t order;
+        std::shared_ptr<const node> left;
+        std::shared_ptr<const node> right;
+        int height;
+    };
+    using node_ptr = std::shared_ptr<const node>;
+
+  public:
+    /// @brief In order iterator, valid as long as the map it came from
+    class const_iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = persistent_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return m_path.back()->entry; };
+        pointer operator->() const { return &m_path.back()->entry; };
+
+        const_iterator& operator++()
+        {
+            const node* done = m_path.back();
+            m_path.pop_back();
+            descend(done->right.get());
+            return *this;
+        };
+        const_iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        };
+
+        bool operator==(const const_iterator& other) const
+        {
+            return m_path.empty() ? other.m_path.empty()
+                                  : !other.m_path.empty() &&
+                                      m_path.back() == other.m_path.back();
+        };
+
+      private:
+        friend class persistent_map;
+
+        explicit const_iterator(const node* root) { descend(root); };
+
+        void descend(const node* at)
+        {
+            for (; at; at = at->left.get()) {
+                m_path.push_back(at);
+            }
+        };
+
+        // Nodes whose entry and right subtree are still to be visited
+        std::vector<const node*> m_path;
+    };
+
+    explicit persistent_map(key_less less = {})
+      : m_less(less){};
+
+    /// @brief Find the value of @name
+    /// @return pointer to the value, or nullptr if @name doesn't exist
+    const T* find(std::string_view name) const
+    {
+        const node* at = m_root.get();
+        while (at) {
+            if (m_less(name, at->entry.first)) {
+                at = at->left.get();
+            } else if (m_less(at->entry.first, name)) {
+                at = at->right.get();
+            } else {
+                return &at->entry.second;
+            }
+        }
+        return nullptr;
+    };
+
+    /// @brief Return a map with @name set to @value. A name that exists
+    /// keeps its spelling and position in insertion order.
+    persistent_map set(std::string name, T value) const
+    {
+        persistent_map result = *this;
+        bool added = false;
+        result.m_root = insert(m_root, name, value, added);
+        if (added) {
+            ++result.m_size;
+            ++result.m_next;
+        }
+        return result;
+    };
+
+    std::size_t size() const { return m_size; };
+    [[nodiscard]] bool empty() const { return m_size == 0; };
+    key_less key_comp() const { return m_less; };
+
+    const_iterator begin() const { return const_iterator(m_root.get()); };
+    const_iterator end() const { return {}; };
+
+    /// @brief The entries in the order their names were first set
+    std::vector<const value_type*> in_insertion_order() const
+    {
+        std::vector<std::pair<std::uint64_t, const value_type*>> entries;
+        entries.reserve(m_size);
+        collect(m_root.get(), entries);
+        std::sort(entries.begin(), entries.end());
+        std::vector<const value_type*> ordered;
+        ordered.reserve(m_size);
+        for (const auto& entry : entries) {
+            ordered.push_back(entry.second);
+        }
+        return ordered;
+    };
+
+  private:
+    key_less m_less;
+    node_ptr m_root;
+    std::size_t m_size = 0;
+    std::uint64_t m_next = 0;
+
+    static int height(const node_ptr& at) { return at ? at->height : 0; };
+
+    static node_ptr make(value_type entry,
+                         std::uint64_t order,
+                         node_ptr left,
+                         node_ptr right)
+    {
+        int height = 1 + std::max(persistent_map::height(left),
+                                  persistent_map::height(right));
+        return std::make_shared<const node>(node{ std::move(entry),
+                                                  order,
+                                                  std::move(left),
+                                                  std::move(right),
+                                                  height });
+    };
+
+    /// A node of @top's entry over @left and @right, rotated back into
+    /// balance after one insertion below it
+    static node_ptr balance(const node& top, node_ptr left, node_ptr right)
+    {
+        if (height(left) > height(right) + 1) {
+            const node& pivot = *left;
+            if (height(pivot.left) >= height(pivot.right)) {
+                return make(pivot.entry,
+                            pivot.order,
+                            pivot.left,
+                            make(top.entry, top.order, pivot.right, right));
+            }
+            const node& inner = *pivot.right;
+            return make(
+              inner.entry,
+              inner.order,
+              make(pivot.entry, pivot.order, pivot.left, inner.left),
+              make(top.entry, top.order, inner.right, right));
+        }
+        if (height(right) > height(left) + 1) {
+            const node& pivot = *right;
+            if (height(pivot.right) >= height(pivot.left)) {
+                return make(pivot.entry,
+                            pivot.order,
+                            make(top.entry, top.order, left, pivot.left),
+                            pivot.right);
+            }
+            const node& inner = *pivot.left;
+            return make(inner.entry,
+                        inner.order,
+                        make(top.entry, top.order, left, inner.left),
+                        make(pivot.entry, pivot.order, inner.right, pivot.right));
+        }
+        return make(top.entry, top.order, std::move(left), std::move(right));
+    };
+
+    node_ptr insert(const node_ptr& at,
+                    std::string& name,
+                    T& value,
+                    bool& added) const
+    {
+        if (!at) {
+            added = true;
+            return make({ std::move(name), std::move(value) }, m_next, {}, {});
+        }
+        if (m_less(name, at->entry.first)) {
+            return balance(*at, insert(at->left, name, value, added), at->right);
+        }
+        if (m_less(at->entry.first, name)) {
+            return balance(*at, at->left, insert(at->right, name, value, added));
+        }
+        return make(
+          { at->entry.first, std::move(value) }, at->order, at->left, at->right);
+    };
+
+    static void collect(
+      const node* at,
+      std::vector<std::pair<std::uint64_t, const value_type*>>& entries)
+    {
+        for (; at; at = at->right.get()) {
+            collect(at->left.get(), entries);
+            entries.emplace_back(at->order, &at->entry);
+        }
+    };
+};
+
+/// @brief Immutable section of an INISnapshot. Its keys are a
+/// persistent_map, so a version setting one key shares all others with the
+/// version before it.
+SIMPLEINI_EXPORT class INISnapshotSection
+{
+  public:
+    using key_table = persistent_map<std::string>;
+    using const_iterator = key_table::const_iterator;
+
+    INISnapshotSection(std::string name, key_table keys)
+      : m_name(std::move(name))
+      , m_keys(std::move(keys)){};
+
+    /// @brief Copy @section
+    INISnapshotSection(const INISection& section, const INIOptions& options)
+      : m_name(section.name())
+      , m_keys(key_less{ options.case_insensitive })
+    {
+        for (const auto& [key, value] : section) {
+            m_keys = m_keys.set(key, value);
+        }
+    };
+
+    /// @brief Name of the section
+    const std::string& name() const { return m_name; };
+
+    /// @brief Number of key value pairs in the section
+    std::size_t size() const { return m_keys.size(); };
+    [[nodiscard]] bool empty() const { return m_keys.empty(); };
+
+    /// @brief Return value of key @key
+    /// @throws std::out_of_range if key doesn't exist
+    const std::string& operator[](std::string_view key) const
+    {
+        return get(key);
+    };
+
+    /// @brief Return value of key @key
+    /// @throws std::out_of_range if key doesn't exist
+    const std::string& get(std::string_view key) const
+    {
+        const auto* value = m_keys.find(key);
+        if (!value) {
+            throw std::out_of_range("No key '" + std::string(key) +
+                                    "' in section '" + m_name + "'");
+        }
+        return *value;
+    };
+
+    /// @brief Find the value of key @key
+    /// @return pointer to the value, or nullptr if the key doesn't exist
+    const std::string* find(std::string_view key) const
+    {
+        return m_keys.find(key);
+    };
+
+    /// @brief Get as type T, converted like INISection::get_as
+    /// @throws INIException if conversion to type T fails.
+    /// @throws std::out_of_range if key doesn't exist.
+    template<typename T>
+    T get_as(std::string_view key) const
+    {
+        return value_as<T>(m_name, key, get(key));
+    }
+
+    /// @brief Iterate the key value pairs in key order
+    const_iterator begin() const { return m_keys.begin(); };
+    const_iterator end() const { return m_keys.end(); };
+
+    /// @brief Return a section with @key set to @value, sharing the other
+    /// keys with this one.
+    INISnapshotSection set(std::string key, std::string value) const
+    {
+        return { m_name, m_keys.set(std::move(key), std::move(value)) };
+    };
+
+    /// @brief Copy into an INISection with the name matching and ordering
+    /// of @options
+    INISection to_section(const INIOptions& options) const
+    {
+        INISection section{ m_name, key_map{}, options };
+        if (options.preserve_order) {
+            for (const auto* entry : m_keys.in_insertion_order()) {
+                section.set(entry->first, entry->second);
+            }
+        } else {
+            for (const auto& [key, value] : m_keys) {
+                section.set(key, value);
+            }
+        }
+        return section;
+    };
+
+  private:
+    std::string m_name;
+    key_table m_keys;
+};
+
+/// @brief Immutable configuration version. Sections and their keys are
+/// shared with the versions before and after it as long as they are not
+/// modified.
+SIMPLEINI_EXPORT class INISnapshot
+{
+  public:
+    using section_map =
+      persistent_map<std::shared_ptr<const INISnapshotSection>>;
+
+    INISnapshot(std::uint64_t version,
+                section_map sections,
+                INIOptions options = {})
+      : m_version(version)
+      , m_sections(std::move(sections))
+      , m_options(std::move(options)){};
+
+    /// @brief Version number of this snapshot
+    std::uint64_t version() const { return m_version; };
+
+    /// @brief Return section with key @key
+    /// @throws std::out_of_range if section doesn't exist
+    const INISnapshotSection& operator[](std::string_view key) const
+    {
+        const auto* found = m_sections.find(key);
+        if (!found) {
+            throw std::out_of_range("No section '" + std::string(key) + "'");
+        }
+        return **found;
+    };
+
+    /// @brief Iterate section names and shared section bodies
+    section_map::const_iterator begin() const { return m_sections.begin(); };
+    section_map::const_iterator end() const { return m_sections.end(); };
+
+    /// @brief Number of sections
+    std::size_t size() const { return m_sections.size(); };
+
+    /// @brief Copy the snapshot into a SimpleINI with the options of its
+    /// history, e.g. to write() it.
+    SimpleINI to_ini() const
+    {
+        SimpleINI config(m_options);
+        auto add = [&](const section_map::value_type& entry) {
+            config.add_section(entry.first,
+                               entry.second->to_section(m_options));
+        };
+        if (m_options.preserve_order) {
+            for (const auto* entry : m_sections.in_insertion_order()) {
+                add(*entry);
+            }
+        } else {
+            for (const auto& entry : m_sections) {
+                add(entry);
+            }
+        }
+        return config;
+    };
+
+  private:
+    friend class VersionedINI;
+
+    std::uint64_t m_version;
+    section_map m_sections;
+    INIOptions m_options;
+};
+
+/// @brief Configuration history where every committed batch of changes
+/// creates a new immutable INISnapshot. Readers acquire the current version
+/// with one atomic load and never wait for a commit being built. The
+/// std::atomic<std::shared_ptr> may itself use a lock, as libstdc++ does, so
+/// a load can wait for a concurrent store to swap the pointer.
+SIMPLEINI_EXPORT class VersionedINI
+{
+  public:
+    using snapshot_ptr = std::shared_ptr<const INISnapshot>;
+
+    /// @brief Changes committed together as one version
+    class batch
+    {
+      public:
+        /// @brief Set the value of @key in section @section. Changes are
+        /// applied in the order they were made, so with case-insensitive
+        /// names the last spelling set wins.
+        void set(const std::string& section, std::string key, std::string value)
+        {
+            m_changes.push_back({ section, std::move(key), std::move(value) });
+        };
+
+        [[nodiscard]] bool empty() const { return m_changes.empty(); };
+
+      private:
+        friend class VersionedINI;
+
+        struct change
+        {
+            std::string section;
+            std::string key;
+            std::string value;
+        };
+
+        std::vector<change> m_changes;
+    };
+
+    /// @brief Create a history whose version 0 holds @config
+    /// @param config initial configuration
+    /// @param max_history number of versions kept for at() and rollback()
+    explicit VersionedINI(const SimpleINI& config = {},
+                          std::size_t max_history = 16)
+      : m_options(config.get_options())
+      , m_max_history(max_history == 0 ? 1 : max_history)
+    {
+        INISnapshot::section_map sections{ key_less{
+          m_options.case_insensitive } };
+        for (const auto& [name, section] : config) {
+            sections = sections.set(
+              name, std::make_shared<INISnapshotSection>(section, m_options));
+        }
+        publish(
+          std::make_shared<INISnapshot>(0, std::move(sections), m_options));
+    };
+
+    /// @brief Get the current version in constant time. Waits at most for a
+    /// concurrent publish() to swap the pointer.
+    snapshot_ptr current() const { return m_current.load(); };
+
+    /// @brief Get version @version
+    /// @throws std::out_of_range if the version was never created or has
+    /// been removed from the history.
+    snapshot_ptr at(std::uint64_t version) const
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto& snapshot : m_history) {
+            if (snapshot->version() == version) {
+                return snapshot;
+            }
+        }
+        throw std::out_of_range("No version " + std::to_string(version));
+    };
+
+    /// @brief Apply @changes as a new version. Each change copies the
+    /// O(log n) tree nodes on the path to its section and key; everything
+    /// else is shared with the previous version.
+    /// @return the new version number
+    std::uint64_t commit(const batch& changes)
+    {
+        std::lock_guard lock(m_mutex);
+        const auto& previous = *m_history.back();
+        INISnapshot::section_map sections = previous.m_sections;
+        for (const auto& change : changes.m_changes) {
+            const auto* found = sections.find(change.section);
+            INISnapshotSection section =
+              found ? **found
+                    : INISnapshotSection{
+                        change.section,
+                        INISnapshotSection::key_table{ sections.key_comp() }
+                      };
+            sections = sections.set(
+              change.section,
+              std::make_shared<const INISnapshotSection>(
+                section.set(change.key, change.value)));
+        }
+        return publish(std::make_shared<INISnapshot>(
+          previous.version() + 1, std::move(sections), m_options));
+    };
+
+    /// @brief Make the contents of version @version current again as a new
+    /// version. Nothing is copied.
+    /// @return the new version number
+    /// @throws std::out_of_range if @version is not in the history
+    std::uint64_t rollback(std::uint64_t version)
+    {
+        auto target = at(version);
+        std::lock_guard lock(m_mutex);
+        return publish(
+          std::make_shared<INISnapshot>(m_history.back()->version() + 1,
+                                        target->m_sections,
+                                        m_options));
+    };
+
+  private:
+    INIOptions m_options;
+    std::size_t m_max_history;
+    std::atomic<snapshot_ptr> m_current;
+    mutable std::mutex m_mutex;
+    std::deque<snapshot_ptr> m_history;
+
+    std::uint64_t publish(snapshot_ptr snapshot)
+    {
+        m_history.push_back(snapshot);
+        if (m_history.size() > m_max_history) {
+            m_history.pop_front();
+        }
+        m_current.store(snapshot);
+        return snapshot->version();
+    };
+};
+}
+
+#endif
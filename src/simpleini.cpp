@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2023 Mike Salmela
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Out-of-line definitions for the simpleini_compiled library.
+
+#define SIMPLEINI_IMPLEMENTATION
+#include "simpleini.h"
+
+namespace simpleini {
+
+template class name_table<std::string>;
+template class name_table<INISection>;
+
+template std::from_chars_result
+from_chars_floating<float>(const char*, const char*, float&);
+template std::from_chars_result
+from_chars_floating<double>(const char*, const char*, double&);
+template std::from_chars_result
+from_chars_floating<long double>(const char*, const char*, long double&);
+template std::from_chars_result
+from_chars_strtold<float>(const char*, const char*, float&);
+template std::from_chars_result
+from_chars_strtold<double>(const char*, const char*, double&);
+template std::from_chars_result
+from_chars_strtold<long double>(const char*, const char*, long double&);
+template bool
+parse_floating<float>(std::string_view, float&);
+template bool
+parse_floating<double>(std::string_view, double&);
+template bool
+parse_floating<long double>(std::string_view, long double&);
+
+template bool
+stream_value<bool>(const std::string&, bool&);
+template bool
+stream_value<char>(const std::string&, char&);
+template bool
+stream_value<signed char>(const std::string&, signed char&);
+template bool
+stream_value<unsigned char>(const std::string&, unsigned char&);
+template bool
+stream_value<short>(const std::string&, short&);
+template bool
+stream_value<unsigned short>(const std::string&, unsigned short&);
+template bool
+stream_value<int>(const std::string&, int&);
+template bool
+stream_value<unsigned>(const std::string&, unsigned&);
+template bool
+stream_value<long>(const std::string&, long&);
+template bool
+stream_value<unsigned long>(const std::string&, unsigned long&);
+template bool
+stream_value<long long>(const std::string&, long long&);
+template bool
+stream_value<unsigned long long>(const std::string&, unsigned long long&);
+template bool
+stream_value<std::string>(const std::string&, std::string&);
+
+template int
+INISection::get_as<int>(std::string_view) const;
+template long
+INISection::get_as<long>(std::string_view) const;
+template long long
+INISection::get_as<long long>(std::string_view) const;
+template unsigned
+INISection::get_as<unsigned>(std::string_view) const;
+template float
+INISection::get_as<float>(std::string_view) const;
+template double
+INISection::get_as<double>(std::string_view) const;
+template std::string
+INISection::get_as<std::string>(std::string_view) const;
+}
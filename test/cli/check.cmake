@@ -0,0 +1,35 @@
+# Runs the ini tool and checks its exit status and output.
+#   INI      path of the ini executable
+#   ARGS     arguments, separated by '|'
+#   STATUS   expected exit status
+#   OUTPUT   optional file holding the expected standard output
+#   ERROR    optional file holding the expected standard error
+# Paths in ARGS are relative to the directory of this script.
+
+cmake_minimum_required(VERSION 3.16)
+
+string(REPLACE "|" ";" args "${ARGS}")
+execute_process(
+    COMMAND ${INI} ${args}
+    WORKING_DIRECTORY ${CMAKE_CURRENT_LIST_DIR}
+    RESULT_VARIABLE status
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error)
+
+if(NOT status STREQUAL STATUS)
+    message(FATAL_ERROR "ini ${args}: exit status ${status}, expected ${STATUS}\n"
+        "stdout:\n${output}\nstderr:\n${error}")
+endif()
+
+function(check_stream name actual expected_file)
+    if(expected_file)
+        file(READ ${CMAKE_CURRENT_LIST_DIR}/${expected_file} expected)
+        if(NOT actual STREQUAL expected)
+            message(FATAL_ERROR "ini ${args}: unexpected ${name}:\n${actual}\n"
+                "expected:\n${expected}")
+        endif()
+    endif()
+endfunction()
+
+check_stream(stdout "${output}" "${OUTPUT}")
+check_stream(stderr "${error}" "${ERROR}")
@@ -1,11 +1,27 @@
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
 
 #include <simpleini.h>
+#include <simpleini_concurrent.h>
+#include <simpleini_enum.h>
+#include <simpleini_fleet.h>
+#include <simpleini_index.h>
+#include <simpleini_notify.h>
+#include <simpleini_parser.h>
+#include <simpleini_reload.h>
+#include <simpleini_server.h>
+#include <simpleini_store.h>
+#include <simpleini_versioned.h>
 
 #define NAME simple_ini_test
 
@@ -104,7 +120,7 @@ TEST(NAME, get_as_any)
 
 TEST(NAME, write_file)
 {
-    std::filesystem::path tmpconf{ "/tmp/tmpconf" };
+    std::filesystem::path tmpconf{ "./tmpconf.ini" };
     simpleini::SimpleINI test;
     test.set_config_file(tmpconf, false);
     simpleini::INISection test_section{ "test",
@@ -116,6 +132,1289 @@ TEST(NAME, write_file)
     ASSERT_TRUE(read_test["test"]["abc"] == "123");
 }
 
+TEST(NAME, iterate)
+{
+    const simpleini::SimpleINI test(TESTCONFIG);
+    ASSERT_EQ(test.size(), 4);
+
+    std::vector<std::string> names;
+    for (const auto& [name, section] : test) {
+        ASSERT_EQ(name, section.name());
+        names.push_back(name);
+    }
+    ASSERT_TRUE(std::ranges::equal(names, test.section_names()));
+    ASSERT_NE(std::ranges::find(test.section_names(), "test section"),
+              test.section_names().end());
+
+    const auto& abc = test["abc"];
+    ASSERT_EQ(abc.size(), 3);
+    ASSERT_EQ(std::ranges::count_if(
+                abc.values(), [](const auto& v) { return v.ends_with(' '); }),
+              0);
+    ASSERT_EQ(*std::ranges::max_element(abc.keys()), "val3");
+    ASSERT_EQ(std::ranges::distance(test["empty section"]), 0);
+}
+
+TEST(NAME, build_in_place)
+{
+    std::map<std::string, std::string> values{ { "a", "1" } };
+    simpleini::INISection moved{ "moved", std::move(values) };
+    ASSERT_EQ(moved["a"], "1");
+
+    simpleini::SimpleINI test;
+    test.add_section("moved", std::move(moved));
+    test.set("built", "key", "value");
+    auto& built = test.emplace_section("built");
+    built.set("key", "changed");
+    ASSERT_TRUE(built.emplace("other", "1"));
+    ASSERT_FALSE(built.emplace("other", "2"));
+
+    ASSERT_EQ(test.size(), 2);
+    ASSERT_EQ(test["moved"]["a"], "1");
+    ASSERT_EQ(test["built"]["key"], "changed");
+    ASSERT_EQ(test["built"]["other"], "1");
+    ASSERT_EQ(test["built"].name(), "built");
+}
+
+TEST(NAME, visitor_parse)
+{
+    struct counter
+    {
+        int sections = 0;
+        int keys = 0;
+        int comments = 0;
+        std::vector<std::size_t> errors;
+        void on_section(std::string_view) { ++sections; }
+        void on_key_value(std::string_view key, std::string_view value)
+        {
+            ++keys;
+            ASSERT_FALSE(key.ends_with(' '));
+            ASSERT_FALSE(value.starts_with(' '));
+        }
+        void on_comment(std::string_view) { ++comments; }
+        void on_error(std::string_view, std::size_t line_number)
+        {
+            errors.push_back(line_number);
+        }
+    };
+
+    counter from_file;
+    std::ifstream stream(TESTCONFIG);
+    simpleini::parse(stream, from_file);
+    ASSERT_EQ(from_file.sections, 4);
+    ASSERT_EQ(from_file.keys, 7);
+    ASSERT_EQ(from_file.comments, 2);
+    ASSERT_TRUE(from_file.errors.empty());
+
+    counter from_text;
+    simpleini::parse("[a]\nkey = value\nbroken\n#c", from_text);
+    ASSERT_EQ(from_text.sections, 1);
+    ASSERT_EQ(from_text.keys, 1);
+    ASSERT_EQ(from_text.comments, 1);
+    ASSERT_EQ(from_text.errors, std::vector<std::size_t>{ 3 });
+
+    struct keys_only
+    {
+        void on_key_value(std::string_view, std::string_view) {}
+    };
+    ASSERT_THROW(simpleini::parse("broken", keys_only{}),
+                 simpleini::INIException);
+}
+
+TEST(NAME, section_filter)
+{
+    simpleini::INIOptions options;
+    options.sections = { "abc", "with*" };
+    simpleini::SimpleINI test(TESTCONFIG, options);
+    ASSERT_EQ(test.size(), 2);
+    ASSERT_EQ(test["abc"]["val3"], "nice");
+    ASSERT_EQ(test["with comment"]["hey"], "aloha");
+    ASSERT_THROW(test["test section"], std::out_of_range);
+
+    struct skip_all
+    {
+        std::vector<std::size_t> errors;
+        bool on_section(std::string_view name) { return name == "b"; }
+        void on_key_value(std::string_view key, std::string_view)
+        {
+            ASSERT_EQ(key, "kept");
+        }
+        void on_error(std::string_view, std::size_t line_number)
+        {
+            errors.push_back(line_number);
+        }
+    };
+    const std::string text = "[a]\nskipped = 1\nnot parsed\n[b]\nkept = 1\n"
+                             "broken\n[c]\nskipped = 2\n";
+    skip_all from_text;
+    simpleini::parse(text, from_text);
+    ASSERT_EQ(from_text.errors, std::vector<std::size_t>{ 6 });
+
+    skip_all from_stream;
+    std::istringstream stream(text);
+    simpleini::parse(stream, from_stream);
+    ASSERT_EQ(from_stream.errors, std::vector<std::size_t>{ 6 });
+}
+
+TEST(NAME, case_insensitive)
+{
+    simpleini::SimpleINI sensitive(TESTCONFIG);
+    ASSERT_THROW(sensitive["ABC"], std::out_of_range);
+
+    simpleini::INIOptions options;
+    options.case_insensitive = true;
+    simpleini::SimpleINI test(TESTCONFIG, options);
+    ASSERT_EQ(test["ABC"]["VAL1"], "hello with trailing");
+    ASSERT_EQ(test["Test Section"]["testvalue"], "hey");
+    ASSERT_EQ(test["test section"].begin()->first, "normal");
+    ASSERT_EQ(std::string(*test.section_names().begin()), "abc");
+
+    test.set("NEW", "Key", "1");
+    test.set("new", "KEY", "2");
+    ASSERT_EQ(test["New"].size(), 1);
+    ASSERT_EQ(test["new"]["key"], "2");
+    ASSERT_EQ(test["new"].begin()->first, "Key")
+      << "Original spelling not preserved.";
+
+    options.sections = { "ABC", "WITH*" };
+    simpleini::SimpleINI filtered(TESTCONFIG, options);
+    ASSERT_EQ(filtered.size(), 2);
+    ASSERT_EQ(filtered["abc"]["val3"], "nice");
+    ASSERT_EQ(filtered["With Comment"]["hey"], "aloha");
+
+    simpleini::INIFleet fleet({ TESTCONFIG }, options);
+    ASSERT_NE(fleet.column("abc", "val3"), nullptr);
+    ASSERT_NE(fleet.column("with comment", "hey"), nullptr);
+    ASSERT_EQ(fleet.column("test section", "normal"), nullptr);
+
+    options.case_insensitive = false;
+    ASSERT_EQ(simpleini::SimpleINI(TESTCONFIG, options).size(), 0);
+}
+
+TEST(NAME, concurrent_access)
+{
+    simpleini::ConcurrentINI test{ simpleini::SimpleINI(TESTCONFIG) };
+    ASSERT_EQ(test.get("abc", "val3"), "nice");
+    ASSERT_THROW(test.get("no section", "val3"), std::out_of_range);
+
+    static constexpr int iterations = 2000;
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < 4; ++writer) {
+        threads.emplace_back([&test, writer] {
+            const std::string section = "counter" + std::to_string(writer);
+            for (int i = 1; i <= iterations; ++i) {
+                test.set(section, "value", std::to_string(i));
+            }
+        });
+    }
+    for (int reader = 0; reader < 4; ++reader) {
+        threads.emplace_back([&test] {
+            for (int i = 0; i < iterations; ++i) {
+                ASSERT_EQ(test.get_as<int>("abc", "val2"), 3);
+                try {
+                    auto value = test.get_as<int>("counter0", "value");
+                    ASSERT_GE(value, 1);
+                    ASSERT_LE(value, iterations);
+                } catch (std::out_of_range&) {
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto snapshot = test.snapshot();
+    for (int writer = 0; writer < 4; ++writer) {
+        ASSERT_EQ(snapshot["counter" + std::to_string(writer)]["value"],
+                  std::to_string(iterations));
+    }
+
+    simpleini::INIOptions options;
+    options.case_insensitive = true;
+    simpleini::ConcurrentINI folded{ simpleini::SimpleINI(options) };
+    folded.set("App", "Key", "1");
+    ASSERT_EQ(folded.get("app", "key"), "1");
+    auto folded_snapshot = folded.snapshot();
+    ASSERT_TRUE(folded_snapshot.get_options().case_insensitive);
+    ASSERT_NE(folded_snapshot.find("APP"), nullptr);
+
+    // Readers keep finding sections while added ones grow the section table
+    simpleini::ConcurrentINI growing;
+    std::jthread adder([&growing] {
+        for (int i = 0; i < iterations; ++i) {
+            growing.set("added" + std::to_string(i), "value", "1");
+        }
+    });
+    std::jthread finder([&growing] {
+        for (int i = 0; i < iterations;) {
+            try {
+                ASSERT_EQ(growing.get("added" + std::to_string(i), "value"),
+                          "1");
+                ++i;
+            } catch (std::out_of_range&) {
+            }
+        }
+    });
+    finder.join();
+    ASSERT_EQ(growing.snapshot().size(), iterations);
+}
+
+TEST(NAME, versioned)
+{
+    simpleini::VersionedINI test{ simpleini::SimpleINI(TESTCONFIG), 2 };
+    auto initial = test.current();
+    ASSERT_EQ(initial->version(), 0);
+
+    simpleini::VersionedINI::batch changes;
+    changes.set("abc", "val3", "changed");
+    changes.set("new", "key", "value");
+    ASSERT_EQ(test.commit(changes), 1);
+
+    auto updated = test.current();
+    ASSERT_EQ((*updated)["abc"]["val3"], "changed");
+    ASSERT_EQ((*updated)["new"]["key"], "value");
+    ASSERT_EQ((*initial)["abc"]["val3"], "nice");
+    ASSERT_THROW((*initial)["new"], std::out_of_range);
+    ASSERT_EQ(&(*initial)["test section"], &(*updated)["test section"])
+      << "Unmodified section not shared.";
+
+    ASSERT_EQ(test.rollback(0), 2);
+    ASSERT_EQ((*test.current())["abc"]["val3"], "nice");
+    ASSERT_THROW(test.at(0), std::out_of_range) << "History not bounded.";
+    ASSERT_EQ(test.at(1), updated);
+    ASSERT_EQ(test.current()->to_ini()["abc"]["val1"], "hello with trailing");
+
+    // Changes apply in call order, with the history's name matching
+    simpleini::INIOptions options;
+    options.case_insensitive = true;
+    simpleini::VersionedINI folded{ simpleini::SimpleINI(options) };
+    simpleini::VersionedINI::batch ordered;
+    ordered.set("app", "key", "first");
+    ordered.set("APP", "KEY", "second");
+    folded.commit(ordered);
+    ASSERT_EQ(folded.current()->size(), 1);
+    ASSERT_EQ((*folded.current())["App"]["Key"], "second");
+    ASSERT_NE(folded.current()->to_ini().find("APP"), nullptr);
+
+    // Setting one key copies only the keys on its path through the tree
+    simpleini::SimpleINI large;
+    for (int i = 0; i < 1024; ++i) {
+        large.set("big", "key" + std::to_string(i), std::to_string(i));
+    }
+    simpleini::VersionedINI versions{ large };
+    auto before = versions.current();
+    simpleini::VersionedINI::batch one;
+    one.set("big", "key500", "changed");
+    versions.commit(one);
+    auto after = versions.current();
+    ASSERT_EQ((*before)["big"]["key500"], "500");
+    ASSERT_EQ((*after)["big"].get_as<int>("key501"), 501);
+    ASSERT_EQ((*after)["big"].size(), 1024);
+    int copied = 0;
+    for (const auto& [key, value] : (*before)["big"]) {
+        copied += &value != (*after)["big"].find(key);
+    }
+    ASSERT_LE(copied, 24) << "Unmodified keys copied.";
+
+    // Snapshots keep the key order of preserve_order configurations
+    simpleini::INIOptions in_order;
+    in_order.preserve_order = true;
+    simpleini::SimpleINI ordered_config(in_order);
+    ordered_config.set("s", "b", "1");
+    ordered_config.set("s", "a", "2");
+    simpleini::VersionedINI ordered_versions{ ordered_config };
+    simpleini::VersionedINI::batch appended;
+    appended.set("s", "c", "3");
+    appended.set("s", "b", "4");
+    ordered_versions.commit(appended);
+    auto restored = ordered_versions.current()->to_ini();
+    auto keys = restored["s"].keys();
+    ASSERT_EQ(std::vector<std::string>(keys.begin(), keys.end()),
+              (std::vector<std::string>{ "b", "a", "c" }));
+}
+
+TEST(NAME, reload_subscriptions)
+{
+    const std::filesystem::path path{ "./reload.ini" };
+    auto write = [&](const std::string& data) {
+        std::ofstream confstream(path);
+        confstream << data;
+    };
+    write("[app]\nlevel = 1\nname = a\n[app.db]\ntimeout = 5\n[other]\n"
+          "x = 1\n");
+    simpleini::ReloadableINI test(path);
+
+    std::vector<std::string> keys, sections, prefixes;
+    test.subscribe("app", "level", [&](const simpleini::INIChange& change) {
+        keys.push_back(*change.new_value);
+    });
+    test.subscribe_section("other", [&](const simpleini::INIChange& change) {
+        sections.push_back(std::string(change.key));
+    });
+    auto id =
+      test.subscribe_prefix("app", [&](const simpleini::INIChange& change) {
+          prefixes.push_back(std::string(change.section) + "." +
+                             std::string(change.key));
+      });
+
+    write("[app]\nlevel = 2\nname = a\n[app.db]\n[other]\nx = 1\n"
+          "y = 2\n");
+    ASSERT_EQ(test.reload(), 3);
+    ASSERT_EQ(test.config()["app"]["level"], "2");
+    ASSERT_EQ(keys, std::vector<std::string>{ "2" });
+    ASSERT_EQ(sections, std::vector<std::string>{ "y" });
+    ASSERT_EQ(prefixes,
+              (std::vector<std::string>{ "app.level", "app.db.timeout" }));
+
+    test.unsubscribe(id);
+    write("[app]\nlevel = 3\n");
+    ASSERT_EQ(test.reload(), 4);
+    ASSERT_EQ(keys, (std::vector<std::string>{ "2", "3" }));
+    ASSERT_EQ(prefixes.size(), 2);
+}
+
+TEST(NAME, reload_notification)
+{
+    const std::filesystem::path path{ "./notify.ini" };
+    const std::filesystem::path directory{ "./notify.d" };
+    std::filesystem::remove_all(directory);
+    std::ofstream(path) << "[app]\nlevel = 1\n";
+
+    int ready[2], results[2];
+    ASSERT_EQ(pipe(ready), 0);
+    ASSERT_EQ(pipe(results), 0);
+    constexpr int consumers = 3;
+    std::vector<pid_t> children;
+    for (int i = 0; i < consumers; ++i) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            char status = 'f';
+            {
+                simpleini::ReloadableINI config(path);
+                simpleini::ReloadChannel channel(directory);
+                write(ready[1], "r", 1);
+                auto generation = channel.wait(5000);
+                if (generation &&
+                    *generation == simpleini::config_generation(path)) {
+                    config.reload();
+                    status = config.config()["app"]["level"] == "2" ? 'o' : 'f';
+                }
+            }
+            write(results[1], &status, 1);
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+
+    simpleini::ReloadChannel channel(directory);
+    simpleini::ReloadWatcher watcher(path, channel);
+    for (int i = 0; i < consumers; ++i) {
+        char byte;
+        ASSERT_EQ(read(ready[0], &byte, 1), 1);
+    }
+    ASSERT_FALSE(watcher.check());
+
+    // Replace the file like an editor saving it, with the same size and
+    // modification time, so only its inode tells the versions apart
+    const std::filesystem::path replacement{ "./notify.ini.new" };
+    std::ofstream(replacement) << "[app]\nlevel = 2\n";
+    std::filesystem::last_write_time(replacement,
+                                     std::filesystem::last_write_time(path));
+    std::filesystem::rename(replacement, path);
+    ASSERT_TRUE(watcher.check());
+    ASSERT_FALSE(channel.wait()) << "Broadcast sent to self.";
+
+    for (int i = 0; i < consumers; ++i) {
+        char status = 0;
+        ASSERT_EQ(read(results[0], &status, 1), 1);
+        ASSERT_EQ(status, 'o');
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    // Of several queued broadcasts the last one is current, whatever its value
+    simpleini::ReloadChannel consumer(directory);
+    ASSERT_EQ(channel.broadcast(2), 1);
+    ASSERT_EQ(channel.broadcast(1), 1);
+    ASSERT_EQ(consumer.wait(1000), 1);
+
+    // A socket path that doesn't fit fails without leaking a descriptor
+    auto open_fds = [] {
+        auto fds = std::filesystem::directory_iterator("/proc/self/fd");
+        return std::distance(begin(fds), end(fds));
+    };
+    const auto fds = open_fds();
+    ASSERT_THROW(simpleini::ReloadChannel(directory / std::string(120, 'd')),
+                 simpleini::INIException);
+    ASSERT_THROW(simpleini::INIClient(directory / std::string(120, 'c')),
+                 simpleini::INIException);
+    ASSERT_EQ(open_fds(), fds);
+    std::filesystem::remove_all(directory / std::string(120, 'd'));
+}
+
+TEST(NAME, query_server)
+{
+    const std::filesystem::path socket{ "./query.sock" };
+    simpleini::INIServer server(socket, TESTCONFIG);
+    std::thread serving([&server] { server.run(10); });
+
+    {
+        simpleini::INIClient client(socket);
+        ASSERT_EQ(client.get("abc", "val1"), "hello with trailing");
+        ASSERT_THROW(client.get("abc", "no key"), std::out_of_range);
+        ASSERT_THROW(client.section("no section"), std::out_of_range);
+
+        auto section = client.section("test section");
+        ASSERT_EQ(section.size(), 3);
+        ASSERT_EQ(section.get_as<int>("with space"), 123);
+
+        auto prefixed = client.prefix("te");
+        ASSERT_EQ(prefixed.size(), 1);
+        ASSERT_EQ(prefixed["test section"]["normal"], "yep");
+
+        using kind = simpleini::INIQuery::kind;
+        auto results = client.query({ { kind::get, "abc", "val3" },
+                                      { kind::get, "abc", "missing" },
+                                      { kind::section, "with comment", "" } });
+        ASSERT_EQ(results.size(), 3);
+        ASSERT_EQ(results[0]->front().value, "nice");
+        ASSERT_FALSE(results[1]);
+        ASSERT_EQ(results[2]->front().key, "hey");
+
+        std::vector<simpleini::INIQuery> too_many(
+          simpleini::wire::max_queries + 1, { kind::get, "abc", "val1" });
+        ASSERT_THROW(client.query(too_many), simpleini::INIException);
+    }
+
+    auto connect = [&socket] {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        auto address = simpleini::posix::make_address(socket);
+        EXPECT_EQ(::connect(fd,
+                            reinterpret_cast<const sockaddr*>(&address),
+                            sizeof(address)),
+                  0);
+        return fd;
+    };
+
+    // A client stalled halfway through a request doesn't hold up the others
+    int stalled = connect();
+    const std::uint32_t partial = 100;
+    ASSERT_EQ(::send(stalled, &partial, sizeof(partial), 0), sizeof(partial));
+    {
+        simpleini::INIClient client(socket);
+        ASSERT_EQ(client.get("abc", "val3"), "nice");
+    }
+
+    // Requests over the size limit are refused before anything is allocated
+    int greedy = connect();
+    const std::uint32_t huge = simpleini::wire::max_request_size + 1;
+    ASSERT_EQ(::send(greedy, &huge, sizeof(huge), 0), sizeof(huge));
+    char byte = 0;
+    ASSERT_EQ(::recv(greedy, &byte, 1, 0), 0) << "Oversized request accepted.";
+    ::close(greedy);
+    ::close(stalled);
+
+    // Unknown query kinds are malformed
+    int unknown = connect();
+    std::string request;
+    simpleini::wire::put_u32(request, 20);
+    simpleini::wire::put_u32(request, 1);
+    request.push_back(4);
+    simpleini::wire::put_string(request, "abc");
+    simpleini::wire::put_string(request, "val1");
+    ASSERT_TRUE(
+      simpleini::wire::write_all(unknown, request.data(), request.size()));
+    ASSERT_EQ(::recv(unknown, &byte, 1, 0), 0) << "Unknown query answered.";
+    ::close(unknown);
+
+    server.stop();
+    serving.join();
+
+    // Prefix queries repeating a large configuration can't make the server
+    // buffer responses without bound
+    const std::filesystem::path large{ "./query_large.ini" };
+    std::ofstream(large) << "[big]\nvalue = " << std::string(1024, 'v')
+                         << "\n";
+    simpleini::INIServer large_server(socket, large);
+    std::thread serving_large([&large_server] { large_server.run(10); });
+    {
+        using kind = simpleini::INIQuery::kind;
+        simpleini::INIClient client(socket);
+        std::vector<simpleini::INIQuery> everything(
+          simpleini::wire::max_queries, { kind::prefix, "", "" });
+        ASSERT_THROW(client.query(everything), simpleini::INIException);
+        simpleini::INIClient other(socket);
+        ASSERT_EQ(other.get("big", "value").size(), 1024);
+    }
+    large_server.stop();
+    serving_large.join();
+    std::filesystem::remove(large);
+
+    // Clients match names like a case insensitive server
+    const std::filesystem::path folded{ "./query_folded.ini" };
+    std::ofstream(folded) << "[Net.A]\nHost = a\n[net.b]\nport = 1\n"
+                          << "[Other]\nx = 1\n";
+    simpleini::INIOptions options;
+    options.case_insensitive = true;
+    simpleini::INIServer folded_server(socket, folded, options);
+    std::thread serving_folded([&folded_server] { folded_server.run(10); });
+    {
+        simpleini::INIClient client(socket);
+        auto prefixed = client.prefix("NET.");
+        ASSERT_EQ(prefixed.size(), 2);
+        ASSERT_EQ(prefixed["net.a"]["host"], "a");
+        ASSERT_EQ(prefixed["NET.B"]["PORT"], "1");
+        auto section = client.section("net.a");
+        ASSERT_EQ(section.name(), "Net.A");
+        ASSERT_EQ(section["HOST"], "a");
+    }
+    folded_server.stop();
+    serving_folded.join();
+    std::filesystem::remove(folded);
+
+    // Descriptors aren't inherited by child processes
+    int fd = simpleini::posix::socket(SOCK_STREAM);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(::fcntl(fd, F_GETFD) & FD_CLOEXEC);
+    ::close(fd);
+}
+
+TEST(NAME, dense_index)
+{
+    simpleini::INIIndex test{ simpleini::SimpleINI(TESTCONFIG) };
+    ASSERT_EQ(test.sections(), 4);
+    ASSERT_EQ(test.size(), 7);
+
+    auto abc = test.section("abc");
+    auto val2 = test.key(abc, "val2");
+    ASSERT_EQ(test[val2], "3 with leading");
+    ASSERT_EQ(test.key_name(val2), "val2");
+    ASSERT_EQ(test[test.key("with comment", "hey")], "aloha");
+
+    auto empty = test.section("empty section");
+    ASSERT_EQ(test.first_key(empty), test.first_key(empty + 1));
+    ASSERT_EQ(test.first_key(test.sections()), test.size());
+    ASSERT_THROW(test.section("no section"), std::out_of_range);
+    ASSERT_THROW(test.key(abc, "normal"), std::out_of_range)
+      << "Key of another section resolved.";
+}
+
+TEST(NAME, resource_limits)
+{
+    auto load = [](auto set_limit) {
+        simpleini::INIOptions options;
+        set_limit(options.limits);
+        return simpleini::SimpleINI(TESTCONFIG, options);
+    };
+    auto message = [&](auto set_limit) {
+        try {
+            load(set_limit);
+        } catch (const simpleini::INIException& error) {
+            return std::string(error.what());
+        }
+        return std::string();
+    };
+
+    ASSERT_NO_THROW(load([](auto& limits) { limits.max_sections = 4; }));
+    ASSERT_EQ(message([](auto& limits) { limits.max_sections = 3; }),
+              "Line 14 exceeds the maximum number of sections of 3");
+    ASSERT_EQ(message([](auto& limits) { limits.max_keys_per_section = 2; }),
+              "Line 7 exceeds the maximum number of keys in a section of 2");
+    ASSERT_EQ(message([](auto& limits) { limits.max_line_length = 20; }),
+              "Line 3 is longer than the maximum line length of 20");
+    ASSERT_THROW(load([](auto& limits) { limits.max_total_bytes = 50; }),
+                 simpleini::INIException);
+    ASSERT_THROW(load([](auto& limits) { limits.max_file_size = 100; }),
+                 simpleini::INIException);
+
+    struct ignore
+    {};
+    simpleini::INILimits limits;
+    limits.max_line_length = 8;
+    std::istringstream overlong("[a]\n" + std::string(1 << 20, 'x') + "\n");
+    ASSERT_THROW(simpleini::parse(overlong, ignore{}, limits),
+                 simpleini::INIException);
+    std::istringstream fits("[a]\nkey = 1\n");
+    ASSERT_NO_THROW(simpleini::parse(fits, ignore{}, limits));
+
+    // A last line without a newline isn't charged for one
+    const std::string unterminated = "[a]\nk=v";
+    limits = {};
+    limits.max_file_size = unterminated.size();
+    ASSERT_NO_THROW(simpleini::parse(unterminated, ignore{}, limits));
+    std::istringstream stream(unterminated);
+    ASSERT_NO_THROW(simpleini::parse(stream, ignore{}, limits));
+    const std::filesystem::path path{ "./unterminated.ini" };
+    std::ofstream(path) << unterminated;
+    simpleini::INIOptions options;
+    options.limits = limits;
+    ASSERT_NO_THROW(simpleini::SimpleINI(path, options));
+    limits.max_file_size = unterminated.size() - 1;
+    ASSERT_THROW(simpleini::parse(unterminated, ignore{}, limits),
+                 simpleini::INIException);
+    std::filesystem::remove(path);
+}
+
+TEST(NAME, non_regular_files)
+{
+    // A pipe has no size up front, so it is read until its end
+    const std::filesystem::path fifo{ "./config.fifo" };
+    std::filesystem::remove(fifo);
+    ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+    auto write = [&fifo](std::string content) {
+        return std::thread(
+          [&fifo, content] { std::ofstream(fifo) << content; });
+    };
+
+    std::thread writer = write("[a]\nk = v\n");
+    simpleini::SimpleINI test(fifo);
+    writer.join();
+    ASSERT_EQ(test["a"]["k"], "v");
+
+    simpleini::INIOptions options;
+    options.limits.max_file_size = 8;
+    writer = write("[a]\nk = v\n");
+    ASSERT_THROW(simpleini::SimpleINI(fifo, options), simpleini::INIException);
+    writer.join();
+
+    writer = write("[a]\nk = v\n");
+    simpleini::INIFleet fleet({ fifo });
+    writer.join();
+    ASSERT_EQ(*fleet.column("a", "k")->value(0), "v");
+    std::filesystem::remove(fifo);
+}
+
+TEST(NAME, long_values)
+{
+    const std::filesystem::path path{ "./long.ini" };
+    const std::string certificate(4 << 20, 'c');
+    std::ofstream(path) << "[tls]\ncert = " << certificate << "\n"
+                        << "key = short\n[other]\nx = 1";
+    simpleini::SimpleINI test(path);
+    ASSERT_EQ(test["tls"]["cert"].size(), certificate.size());
+    ASSERT_EQ(test["tls"]["cert"], certificate);
+    ASSERT_EQ(test["tls"]["key"], "short");
+    ASSERT_EQ(test["other"]["x"], "1") << "Last line without newline lost.";
+}
+
+TEST(NAME, decode_types)
+{
+    ASSERT_EQ(simpleini::decode_value("42"), simpleini::INIValue{ 42LL });
+    ASSERT_EQ(simpleini::decode_value("-1.5"), simpleini::INIValue{ -1.5 });
+    ASSERT_EQ(simpleini::decode_value("Off"), simpleini::INIValue{ false });
+    ASSERT_FALSE(simpleini::decode_value("3 with leading"));
+    ASSERT_FALSE(simpleini::decode_value(""));
+
+    const std::filesystem::path path{ "./typed.ini" };
+    {
+        std::ofstream confstream(path);
+        for (int section = 0; section < 8; ++section) {
+            confstream << "[s" << section << "]\n";
+            for (int key = 0; key < 10000; ++key) {
+                confstream << "i" << key << " = " << key << "\n"
+                           << "f" << key << " = " << key << ".5\n";
+            }
+            confstream << "flag = yes\nbig = 5000000000\ntext = hello\n";
+        }
+    }
+    simpleini::INIOptions options;
+    options.decode_types = true;
+    simpleini::SimpleINI test(path, options);
+    for (int section = 0; section < 8; ++section) {
+        const auto& typed = test["s" + std::to_string(section)];
+        ASSERT_EQ(typed.get_as<int>("i9999"), 9999);
+        ASSERT_EQ(typed.get_as<double>("f10"), 10.5);
+        // get_as<bool> keeps the stream rules whatever the load options
+        ASSERT_THROW(typed.get_as<bool>("flag"), simpleini::INIException);
+        ASSERT_TRUE(typed.get_bool("flag"));
+        ASSERT_EQ(typed.get_as<long long>("big"), 5000000000LL);
+        ASSERT_THROW(typed.get_as<int>("big"), simpleini::INIException);
+        ASSERT_EQ(typed.get_typed("text"), nullptr);
+        ASSERT_EQ(*typed.get_typed("i7"), simpleini::INIValue{ 7LL });
+    }
+
+    auto& changed = test.emplace_section("s0");
+    changed.set("i1", "not a number");
+    ASSERT_EQ(changed.get_typed("i1"), nullptr);
+    ASSERT_THROW(changed.get_as<int>("i1"), simpleini::INIException);
+    std::filesystem::remove(path);
+
+    std::ofstream(path) << "[s]\nport = 80\nletter = 7\nhuge = 1e39\n"
+                        << "x = 1.000000059604644775390625000001\n";
+    options.case_insensitive = true;
+    simpleini::SimpleINI folded(path, options);
+    auto& section = folded.emplace_section("s");
+    section.set("PORT", "8080");
+    ASSERT_EQ(section.get_as<int>("port"), 8080);
+    ASSERT_EQ(section.get_as<char>("letter"), '7');
+    ASSERT_THROW(section.get_as<float>("huge"), simpleini::INIException);
+    ASSERT_EQ(section.get_as<double>("huge"), 1e39);
+    // Rounded once from the text, not again from the cached double
+    ASSERT_EQ(section.get_as<float>("x"),
+              std::strtof("1.000000059604644775390625000001", nullptr));
+    ASSERT_NE(section.get_as<float>("x"), 1.0f);
+    ASSERT_EQ(section.get_as<long double>("x"),
+              std::strtold("1.000000059604644775390625000001", nullptr));
+    std::filesystem::remove(path);
+}
+
+TEST(NAME, parse_floating)
+{
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<int> digits(1, 20);
+    std::uniform_int_distribution<int> exponent(-330, 310);
+    char buffer[64];
+    for (int i = 0; i < 200000; ++i) {
+        if (i % 2) {
+            std::uint64_t bits = random();
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            if (!std::isfinite(value)) {
+                continue;
+            }
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+        } else {
+            std::string mantissa;
+            for (int d = digits(random); d > 0; --d) {
+                mantissa += static_cast<char>('0' + random() % 10);
+            }
+            std::snprintf(buffer,
+                          sizeof(buffer),
+                          "%s.%se%d",
+                          random() % 2 ? "-" : "",
+                          mantissa.c_str(),
+                          exponent(random));
+        }
+        double expected = std::strtod(buffer, nullptr);
+        double parsed = 0;
+        bool ok = simpleini::parse_floating(buffer, parsed);
+        if (std::fabs(expected) == HUGE_VAL) {
+            ASSERT_FALSE(ok) << buffer;
+            continue;
+        }
+        ASSERT_TRUE(ok) << buffer;
+        ASSERT_EQ(std::memcmp(&expected, &parsed, sizeof(parsed)), 0)
+          << buffer;
+    }
+
+    simpleini::INISection test{ "floats",
+                                { { "pi", "3.14159265358979323846" },
+                                  { "plus", "+2.5e-3" },
+                                  { "bad", "pi" } } };
+    ASSERT_EQ(test.get_as<double>("pi"), 3.141592653589793);
+    ASSERT_EQ(test.get_as<float>("pi"), 3.14159265f);
+    ASSERT_EQ(test.get_as<double>("plus"), 2.5e-3);
+    ASSERT_THROW(test.get_as<double>("bad"), simpleini::INIException);
+
+    // operator>> rules: no inf or nan, underflow reads as zero of its sign
+    double value = 1;
+    for (const char* text : { "inf", "-infinity", "nan", "+nan", "-" }) {
+        ASSERT_FALSE(simpleini::parse_floating(text, value)) << text;
+    }
+    ASSERT_FALSE(simpleini::decode_value("nan"));
+    ASSERT_TRUE(simpleini::parse_floating("1e-400", value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(simpleini::parse_floating("-0.0001e-320", value));
+    ASSERT_TRUE(value == 0 && std::signbit(value));
+    ASSERT_TRUE(simpleini::parse_floating("1e-99999999999999999999", value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(simpleini::parse_floating("1e-310", value));
+    ASSERT_EQ(value, 1e-310);
+    ASSERT_FALSE(simpleini::parse_floating("1e400", value));
+    ASSERT_FALSE(simpleini::parse_floating("0.01e99999999999999999", value));
+    ASSERT_FALSE(simpleini::parse_floating("12345e305", value));
+    float narrow = 1;
+    ASSERT_TRUE(simpleini::parse_floating("1e-50", narrow));
+    ASSERT_EQ(narrow, 0);
+
+    // The strtold fallback for libraries without std::from_chars for a type
+    // scans the same numbers
+    for (const char* text :
+         { "2.5", "-.5e3x", "1.e", "7e+", "1e-400", "1e400", "12345e305" }) {
+        const char* last = text + std::strlen(text);
+        double expected = 0;
+        double fallback = 0;
+        auto lhs = simpleini::from_chars_floating(text, last, expected);
+        auto rhs = simpleini::from_chars_strtold(text, last, fallback);
+        ASSERT_EQ(lhs.ptr, rhs.ptr) << text;
+        ASSERT_EQ(lhs.ec, rhs.ec) << text;
+        ASSERT_EQ(expected, fallback) << text;
+    }
+    for (const char* text : { "e5", "-", ".", "-.e1" }) {
+        long double fallback = 0;
+        auto result = simpleini::from_chars_strtold(
+          text, text + std::strlen(text), fallback);
+        ASSERT_EQ(result.ec, std::errc::invalid_argument) << text;
+        ASSERT_EQ(result.ptr, text) << text;
+    }
+    long double extended = 0;
+    ASSERT_TRUE(simpleini::parse_floating("1e4000", extended));
+    ASSERT_EQ(extended, std::strtold("1e4000", nullptr));
+}
+
+TEST(NAME, unit_values)
+{
+    using namespace std::chrono_literals;
+    simpleini::INISection test{ "units",
+                                { { "timeout", "250ms" },
+                                  { "window", "1h 30m" },
+                                  { "half", "1.5s" },
+                                  { "no_unit", "30" },
+                                  { "bad_unit", "5 weeks" },
+                                  { "huge", "9999999999999d" },
+                                  { "page", "4KiB" },
+                                  { "disk", "1.5 GB" },
+                                  { "plain", "512" },
+                                  { "short", "2K" },
+                                  { "negative", "-1MB" },
+                                  { "ratio", "75%" },
+                                  { "fraction", "12.5 %" },
+                                  { "yes", "yes" },
+                                  { "off", "OFF" },
+                                  { "one", "1" },
+                                  { "maybe", "maybe" } } };
+    ASSERT_EQ(test.get_duration("timeout"), 250ms);
+    ASSERT_EQ(test.get_duration<std::chrono::minutes>("window"), 90min);
+    ASSERT_EQ(test.get_duration("half"), 1500ms);
+    ASSERT_THROW(test.get_duration("no_unit"), simpleini::INIException);
+    ASSERT_THROW(test.get_duration("bad_unit"), simpleini::INIException);
+    ASSERT_THROW(test.get_duration("huge"), simpleini::INIException);
+    try {
+        test.get_duration("bad_unit");
+    } catch (const simpleini::INIException& e) {
+        ASSERT_NE(std::string(e.what()).find("bad_unit"), std::string::npos);
+    }
+
+    ASSERT_EQ(test.get_bytes("page"), 4096u);
+    ASSERT_EQ(test.get_bytes("disk"), 1500000000u);
+    ASSERT_EQ(test.get_bytes("plain"), 512u);
+    ASSERT_EQ(test.get_bytes("short"), 2048u);
+    ASSERT_THROW(test.get_bytes("negative"), simpleini::INIException);
+    ASSERT_THROW(test.get_bytes("timeout"), simpleini::INIException);
+
+    ASSERT_DOUBLE_EQ(test.get_percent("ratio"), 0.75);
+    ASSERT_DOUBLE_EQ(test.get_percent("fraction"), 0.125);
+    ASSERT_THROW(test.get_percent("plain"), simpleini::INIException);
+
+    ASSERT_TRUE(test.get_bool("yes"));
+    ASSERT_FALSE(test.get_bool("off"));
+    ASSERT_TRUE(test.get_bool("one"));
+    ASSERT_THROW(test.get_bool("maybe"), simpleini::INIException);
+    ASSERT_THROW(test.get_bool("plain"), simpleini::INIException);
+}
+
+enum class log_level
+{
+    debug,
+    info,
+    warning,
+    error
+};
+
+template<>
+struct simpleini::enum_names<log_level>
+{
+    static constexpr std::pair<std::string_view, log_level> names[] = {
+        { "debug", log_level::debug },
+        { "info", log_level::info },
+        { "warning", log_level::warning },
+        { "error", log_level::error },
+    };
+};
+
+enum class opcode
+{
+};
+
+template<>
+struct simpleini::enum_names<opcode>
+{
+    static constexpr std::size_t count = 64;
+
+    // "op00" to "op63"
+    static constexpr auto spelled = [] {
+        std::array<std::array<char, 4>, count> spelled{};
+        for (std::size_t i = 0; i < count; ++i) {
+            spelled[i] = { 'o',
+                           'p',
+                           static_cast<char>('0' + i / 10),
+                           static_cast<char>('0' + i % 10) };
+        }
+        return spelled;
+    }();
+
+    static constexpr auto names = [] {
+        std::array<std::pair<std::string_view, opcode>, count> names{};
+        for (std::size_t i = 0; i < count; ++i) {
+            names[i] = { std::string_view(spelled[i].data(), 4),
+                         static_cast<opcode>(i) };
+        }
+        return names;
+    }();
+};
+
+TEST(NAME, enum_values)
+{
+    static_assert(*simpleini::enum_table<log_level>::find("warning") ==
+                  log_level::warning);
+    static_assert(simpleini::enum_table<log_level>::find("trace") == nullptr);
+
+    using opcodes = simpleini::enum_table<opcode>;
+    static_assert(*opcodes::find("op42") == static_cast<opcode>(42));
+    for (const auto& [name, value] : simpleini::enum_names<opcode>::names) {
+        ASSERT_EQ(opcodes::find(name), &value) << name;
+    }
+    ASSERT_EQ(opcodes::find("op64"), nullptr);
+    ASSERT_EQ(opcodes::find(""), nullptr);
+
+    simpleini::INISection test{ "logging",
+                                { { "level", "info" },
+                                  { "other", "error" },
+                                  { "bad", "verbose" } } };
+    ASSERT_EQ(test.get_as<log_level>("level"), log_level::info);
+    ASSERT_EQ(test.get_as<log_level>("other"), log_level::error);
+    try {
+        test.get_as<log_level>("bad");
+        FAIL();
+    } catch (const simpleini::INIException& e) {
+        ASSERT_NE(std::string(e.what()).find("debug, info, warning, error"),
+                  std::string::npos);
+    }
+}
+
+TEST(NAME, fleet)
+{
+    const std::filesystem::path directory{ "./fleet.d" };
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+    std::vector<std::filesystem::path> files;
+    for (int i = 0; i < 50; ++i) {
+        files.push_back(directory / ("host" + std::to_string(i) + ".ini"));
+        std::ofstream confstream(files.back());
+        confstream << "[db]\ntimeout = " << (i % 5) * 10 << "\n"
+                   << "[logging]\nlevel = " << (i % 2 ? "info" : "debug")
+                   << "\n";
+        if (i == 7) {
+            confstream << "[extra]\nflag = yes\n";
+        }
+    }
+    simpleini::INIFleet fleet(files);
+    ASSERT_EQ(fleet.hosts(), 50);
+    ASSERT_EQ(fleet.column("db", "timeout")->dictionary().size(), 5);
+
+    auto slow =
+      fleet.filter<int>("db", "timeout", [](int t) { return t > 30; });
+    ASSERT_EQ(slow.size(), 10);
+    for (auto host : slow) {
+        ASSERT_EQ(host % 5, 4);
+    }
+    auto flagged =
+      fleet.filter<bool>("extra", "flag", [](bool f) { return f; });
+    ASSERT_EQ(flagged, std::vector<simpleini::INIFleet::host_id>{ 7 });
+    ASSERT_EQ(*fleet.column("extra", "flag")->value(7), "yes");
+    ASSERT_EQ(fleet.column("extra", "flag")->value(8), nullptr);
+    ASSERT_TRUE(fleet.filter("missing", "key", [](auto) { return true; })
+                  .empty());
+
+    auto levels = fleet.group_by("logging", "level");
+    ASSERT_EQ(levels.size(), 2);
+    ASSERT_EQ(levels[0].first, "debug");
+    ASSERT_EQ(levels[0].second, 25);
+    ASSERT_EQ(levels[1].second, 25);
+
+    // Copies own their dictionaries
+    std::optional<simpleini::INIFleet> source(fleet);
+    simpleini::INIFleet copy = *source;
+    source.reset();
+    ASSERT_EQ(copy.group_by("logging", "level"), levels);
+    ASSERT_EQ(*copy.column("extra", "flag")->value(7), "yes");
+
+    // Escaped and continued values don't point into the file content
+    std::ofstream(directory / "syntax.ini")
+      << "[s]\nname = \"a\\tb\"\nscript = one\n  two\n";
+    simpleini::INIOptions options;
+    options.syntax.quoted_values = true;
+    options.syntax.indented_continuation = true;
+    simpleini::INIFleet syntax({ directory / "syntax.ini" }, options);
+    ASSERT_EQ(*syntax.column("s", "name")->value(0), "a\tb");
+    ASSERT_EQ(*syntax.column("s", "script")->value(0), "one\ntwo");
+
+    // Same values as SimpleINI for repeated keys and sections
+    const auto repeated = directory / "repeated.ini";
+    std::ofstream(repeated) << "top=0\n[a]\nk=1\nk=2\n[a]\nk=3\nj=4\n"
+                            << "[t]\nd=45s\nn=1.5\n";
+    simpleini::SimpleINI single(repeated);
+    simpleini::INIFleet duplicates({ repeated });
+    ASSERT_EQ(*duplicates.column("a", "k")->value(0), single["a"]["k"]);
+    ASSERT_EQ(duplicates.column("a", "j"), nullptr);
+    ASSERT_EQ(duplicates.column("", "top"), nullptr);
+    ASSERT_EQ(duplicates.column("a", "k")->dictionary().size(), 1);
+
+    // Numbers have to be the whole value
+    auto any = [](auto) { return true; };
+    ASSERT_TRUE(duplicates.filter<double>("t", "d", any).empty());
+    ASSERT_EQ(duplicates.filter<double>("t", "n", any).size(), 1);
+
+    files.insert(files.begin() + 20, directory / "absent.ini");
+    ASSERT_THROW(simpleini::INIFleet{ files }, simpleini::INIException);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(NAME, section_store)
+{
+    const std::filesystem::path first{ "./store1.ini" };
+    const std::filesystem::path second{ "./store2.ini" };
+    std::ofstream(first) << "[logging]\nlevel = info\nsink = file\n"
+                         << "[host]\nname = a\n";
+    std::ofstream(second) << "[logging]\nlevel = info\nsink = file\n"
+                          << "[host]\nname = b\n";
+
+    simpleini::INIOptions options;
+    options.section_store = std::make_shared<simpleini::INISectionStore>();
+    simpleini::SimpleINI a(first, options);
+    simpleini::SimpleINI b(second, options);
+    ASSERT_EQ(options.section_store->size(), 3);
+    ASSERT_EQ(&a["logging"]["level"], &b["logging"]["level"]);
+    ASSERT_NE(&a["host"]["name"], &b["host"]["name"]);
+
+    a.set("logging", "level", "debug");
+    ASSERT_EQ(a["logging"]["level"], "debug");
+    ASSERT_EQ(b["logging"]["level"], "info");
+    ASSERT_EQ(b.get_map()["logging"]["sink"], "file");
+
+    simpleini::INISection copy = b["logging"];
+    copy.set("level", "warning");
+    ASSERT_EQ(b["logging"]["level"], "info");
+
+    // Decoded sections don't take the body of an identical undecoded one
+    std::ofstream(first) << "[net]\nport = 8080\n";
+    simpleini::SimpleINI plain(first, options);
+    options.decode_types = true;
+    simpleini::SimpleINI decoded(first, options);
+    simpleini::SimpleINI decoded_too(first, options);
+    ASSERT_EQ(plain["net"].get_typed("port"), nullptr);
+    ASSERT_NE(decoded["net"].get_typed("port"), nullptr);
+    ASSERT_EQ(&decoded["net"]["port"], &decoded_too["net"]["port"]);
+    std::filesystem::remove(first);
+    std::filesystem::remove(second);
+}
+
+TEST(NAME, preserve_order)
+{
+    const std::filesystem::path path{ "./ordered.ini" };
+    std::ofstream(path) << "[zeta]\nz = 1\nb = 2\n[Alpha]\ny = 3\nx = 4\n"
+                        << "[mid]\nk = 5\n";
+
+    simpleini::INIOptions options;
+    options.preserve_order = true;
+    options.case_insensitive = true;
+    simpleini::SimpleINI test(path, options);
+    std::vector<std::string> names(test.section_names().begin(),
+                                   test.section_names().end());
+    ASSERT_EQ(names, (std::vector<std::string>{ "zeta", "Alpha", "mid" }));
+    std::vector<std::string> keys(test["zeta"].keys().begin(),
+                                  test["zeta"].keys().end());
+    ASSERT_EQ(keys, (std::vector<std::string>{ "z", "b" }));
+    ASSERT_EQ(test["ALPHA"]["X"], "4");
+    ASSERT_EQ(test.find("nope"), nullptr);
+
+    test.set("zeta", "a", "6");
+    test.set("new", "key", "7");
+    test.write();
+    std::ifstream written(path);
+    std::string output((std::istreambuf_iterator<char>(written)),
+                       std::istreambuf_iterator<char>());
+    ASSERT_EQ(output,
+              "[zeta]\nz = 1\nb = 2\na = 6\n[Alpha]\ny = 3\nx = 4\n"
+              "[mid]\nk = 5\n[new]\nkey = 7\n");
+
+    simpleini::SimpleINI reloaded(path, options);
+    reloaded.set("Alpha", "y", "8");
+    std::vector<std::string> changes;
+    simpleini::diff(test, reloaded, [&](auto section, auto key, auto, auto) {
+        changes.push_back(std::string(section) + "." + std::string(key));
+    });
+    ASSERT_EQ(changes, std::vector<std::string>{ "Alpha.y" });
+
+    simpleini::INIIndex index(test);
+    ASSERT_EQ(index[index.key("zeta", "a")], "6");
+    ASSERT_EQ(index.section_name(0), "Alpha");
+    std::filesystem::remove(path);
+}
+
+TEST(NAME, inline_comments_and_quotes)
+{
+    struct collector
+    {
+        std::vector<std::pair<std::string, std::string>> values;
+        std::vector<std::size_t> errors;
+        void on_key_value(std::string_view key, std::string_view value)
+        {
+            values.emplace_back(key, value);
+        }
+        void on_error(std::string_view, std::size_t line)
+        {
+            errors.push_back(line);
+        }
+    };
+    const std::string_view text = "[s]\n"
+                                  "timeout = 30 ; seconds\n"
+                                  "url = http://host/#anchor\n"
+                                  "color = #fff # hex\n"
+                                  "plain = \"quoted ; kept\" ; comment\n"
+                                  "single = 'no \\n escapes'\n"
+                                  "escaped = \"a\\tb\\\"c\\\\\"\n"
+                                  "empty = \"\"\n"
+                                  "open = \"unterminated\n"
+                                  "trailing = \"x\" y\n"
+                                  "unknown = \"\\q\"\n";
+
+    collector raw;
+    simpleini::parse(text, raw);
+    ASSERT_EQ(raw.values[0].second, "30 ; seconds");
+    ASSERT_TRUE(raw.errors.empty());
+
+    collector parsed;
+    simpleini::parse(text, parsed, {}, { true, true });
+    ASSERT_EQ(parsed.values,
+              (std::vector<std::pair<std::string, std::string>>{
+                { "timeout", "30" },
+                { "url", "http://host/#anchor" },
+                { "color", "" },
+                { "plain", "quoted ; kept" },
+                { "single", "no \\n escapes" },
+                { "escaped", "a\tb\"c\\" },
+                { "empty", "" } }));
+    ASSERT_EQ(parsed.errors, (std::vector<std::size_t>{ 9, 10, 11 }));
+
+    const std::filesystem::path path{ "./syntax.ini" };
+    std::ofstream(path) << "[app]\nretries = 3 # default\n"
+                        << "timeout = 30\t; seconds\n"
+                        << "delay = 5 \t \t# mixed\n";
+    simpleini::INIOptions options;
+    options.syntax.inline_comments = true;
+    simpleini::SimpleINI test(path, options);
+    ASSERT_EQ(test["app"].get_as<int>("retries"), 3);
+    ASSERT_EQ(test["app"]["timeout"], "30");
+    ASSERT_EQ(test["app"].get_as<int>("timeout"), 30);
+    ASSERT_EQ(test["app"]["delay"], "5");
+    std::filesystem::remove(path);
+}
+
+TEST(NAME, continuation_lines)
+{
+    struct collector
+    {
+        std::vector<std::pair<std::string, std::string>> values;
+        void on_key_value(std::string_view key, std::string_view value)
+        {
+            values.emplace_back(key, value);
+        }
+    };
+    using values = std::vector<std::pair<std::string, std::string>>;
+    const std::string_view text = "[s]\n"
+                                  "list = a, \\\n"
+                                  "       b, \\\n"
+                                  "  c\n"
+                                  "script = echo one\n"
+                                  "  echo two\n"
+                                  "\techo three\n"
+                                  "last = x \\";
+
+    // Without continuations the continuation lines are malformed
+    collector raw;
+    ASSERT_THROW(simpleini::parse(text, raw), simpleini::INIException);
+
+    collector backslash;
+    simpleini::INISyntax syntax;
+    syntax.backslash_continuation = true;
+    auto list = text.substr(0, text.find("script"));
+    simpleini::parse(list, backslash, {}, syntax);
+    ASSERT_EQ(backslash.values, (values{ { "list", "a, b, c" } }));
+    collector at_end;
+    simpleini::parse("[s]\nlast = x \\", at_end, {}, syntax);
+    ASSERT_EQ(at_end.values, (values{ { "last", "x" } }));
+    ASSERT_THROW(simpleini::parse(text, backslash, {}, syntax),
+                 simpleini::INIException);
+
+    collector indented;
+    syntax.indented_continuation = true;
+    std::istringstream input{ std::string(text) };
+    simpleini::parse(input, indented, {}, syntax);
+    ASSERT_EQ(indented.values,
+              (values{ { "list", "a, b, c" },
+                       { "script", "echo one\necho two\necho three" },
+                       { "last", "x" } }));
+}
+
+TEST(NAME, continuation_lines_with_comments_and_quotes)
+{
+    struct collector
+    {
+        std::vector<std::pair<std::string, std::string>> values;
+        std::vector<std::size_t> errors;
+        void on_key_value(std::string_view key, std::string_view value)
+        {
+            values.emplace_back(key, value);
+        }
+        void on_error(std::string_view, std::size_t line)
+        {
+            errors.push_back(line);
+        }
+    };
+    using values = std::vector<std::pair<std::string, std::string>>;
+    const std::string_view text = "[s]\n"
+                                  "k = v ; c\n"
+                                  "  more # note\n"
+                                  "list = a ; c \\\n"
+                                  "  b, \\\n"
+                                  "  \"c ; d\" \\\n"
+                                  "  e\n"
+                                  "quoted = \"x\"\n"
+                                  "  \"  y\" ; z\n"
+                                  "notes = first\n"
+                                  "  ; skipped\n"
+                                  "  # skipped\n"
+                                  "  second\n"
+                                  "open = \"x\n"
+                                  "  dropped\n"
+                                  "bad = x\n"
+                                  "  'y\n"
+                                  "  dropped\n"
+                                  "last = 1\n";
+
+    collector parsed;
+    simpleini::parse(text, parsed, {}, { true, true, true, true });
+    ASSERT_EQ(parsed.values,
+              (values{ { "k", "v\nmore" },
+                       { "list", "a b, c ; d e" },
+                       { "quoted", "x\n  y" },
+                       { "notes", "first\nsecond" },
+                       { "last", "1" } }));
+    ASSERT_EQ(parsed.errors, (std::vector<std::size_t>{ 14, 17 }));
+
+    // Values that don't continue are reported before the next line is read,
+    // including escaped ones whose buffer the next line reuses
+    collector streamed;
+    std::istringstream input{ "[s]\na = \"1\\t\"\nb = \"2\\n\"\n"
+                              "c = \"3\\t\"\n  4\nd = 5" };
+    simpleini::parse(input, streamed, {}, { false, true, false, true });
+    ASSERT_EQ(streamed.values,
+              (values{ { "a", "1\t" },
+                       { "b", "2\n" },
+                       { "c", "3\t\n4" },
+                       { "d", "5" } }));
+
+    // Quoted values ending in a backslash continue like plain ones
+    collector quoted;
+    simpleini::parse(
+      "[s]\nk = \"a\"\\\n  b\n", quoted, {}, { false, true, true, false });
+    ASSERT_EQ(quoted.values, (values{ { "k", "ab" } }));
+}
+
 int
 main(int argc, char** argv)
 {
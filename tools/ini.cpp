@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <span>
+#include <thread>
+
+#include <simpleini.h>
+#include <simpleini_parser.h>
+
+namespace {
+
+const char* usage =
+  "Usage: ini <command> [arguments]\n"
+  "\n"
+  "Commands:\n"
+  "  get <section> <key> <file>...  print the value of key in section\n"
+  "  list-sections <file>...        print the section names\n"
+  "  dump <file>...                 print the files in normalized form\n"
+  "  diff <old> <new>               print the keys that differ\n"
+  "  validate <file>...             report every malformed line\n"
+  "  bench [-n runs] <file>...      measure parsing speed\n"
+  "\n"
+  "Exit status: 0 on success, 1 if get finds no key, validate finds a\n"
+  "malformed line or diff finds a change, 2 on usage errors and 3 if a file\n"
+  "can't be read or parsed.\n";
+
+/// Exit status of a file that can't be read or parsed
+constexpr int error_status = 3;
+
+/// Output of one command run on one file
+struct result
+{
+    std::string out;
+    std::string err;
+    int status = 0;
+};
+
+/// Run @command on every file in parallel, streaming the output in the order
+/// of @files as soon as each file is done.
+template<typename Command>
+int
+for_each_file(std::span<char*> files, Command command)
+{
+    std::vector<std::promise<result>> results(files.size());
+    std::atomic<std::size_t> next{ 0 };
+    auto worker = [&] {
+        for (std::size_t i = next++; i < files.size(); i = next++) {
+            result done;
+            try {
+                done = command(std::filesystem::path(files[i]));
+            } catch (const std::exception& error) {
+                done.err = std::string(files[i]) + ": " + error.what() + "\n";
+                done.status = error_status;
+            }
+            results[i].set_value(std::move(done));
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    auto count = std::clamp<std::size_t>(
+      std::thread::hardware_concurrency(), 1, files.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    int status = 0;
+    for (auto& promise : results) {
+        auto done = promise.get_future().get();
+        std::cout << done.out << std::flush;
+        std::cerr << done.err;
+        status = std::max(status, done.status);
+    }
+    return status;
+}
+
+std::string
+label(const std::filesystem::path& file, std::size_t files)
+{
+    return files > 1 ? file.string() + ": " : std::string();
+}
+
+int
+get(std::span<char*> args)
+{
+    if (args.size() < 3) {
+        std::cerr << usage;
+        return 2;
+    }
+    const std::string section = args[0];
+    const std::string key = args[1];
+    auto files = args.subspan(2);
+    return for_each_file(files, [&](const std::filesystem::path& file) {
+        result done;
+        simpleini::SimpleINI config(file);
+        const auto* found = config.find(section);
+        const auto* value = found ? found->find(key) : nullptr;
+        if (value) {
+            done.out = label(file, files.size()) + *value + "\n";
+        } else {
+            done.err = file.string() + ": no key '" + key +
+                       "' in section '" + section + "'\n";
+            done.status = 1;
+        }
+        return done;
+    });
+}
+
+int
+list_sections(std::span<char*> files)
+{
+    return for_each_file(files, [&](const std::filesystem::path& file) {
+        result done;
+        simpleini::SimpleINI config(file);
+        for (const auto& name : config.section_names()) {
+            done.out += label(file, files.size()) + name + "\n";
+        }
+        return done;
+    });
+}
+
+int
+dump(std::span<char*> files)
+{
+    return for_each_file(files, [](const std::filesystem::path& file) {
+        result done;
+        simpleini::SimpleINI config(file);
+        for (const auto& section : config.sections()) {
+            done.out += section.as_string();
+        }
+        return done;
+    });
+}
+
+int
+diff(std::span<char*> args)
+{
+    if (args.size() != 2) {
+        std::cerr << usage;
+        return 2;
+    }
+    simpleini::SimpleINI before(args[0]);
+    simpleini::SimpleINI after(args[1]);
+    int status = 0;
+    simpleini::diff(before,
+                    after,
+                    [&](std::string_view section,
+                        std::string_view key,
+                        const std::string* old_value,
+                        const std::string* new_value) {
+                        status = 1;
+                        if (old_value) {
+                            std::cout << "-[" << section << "] " << key
+                                      << " = " << *old_value << "\n";
+                        }
+                        if (new_value) {
+                            std::cout << "+[" << section << "] " << key
+                                      << " = " << *new_value << "\n";
+                        }
+                    });
+    return status;
+}
+
+int
+validate(std::span<char*> files)
+{
+    struct reporter
+    {
+        const std::filesystem::path& file;
+        result& done;
+
+        void on_error(std::string_view line, std::size_t line_number)
+        {
+            done.err += file.string() + ":" + std::to_string(line_number) +
+                        ": malformed line: " + std::string(line) + "\n";
+            done.status = 1;
+        }
+    };
+
+    return for_each_file(files, [](const std::filesystem::path& file) {
+        result done;
+        std::ifstream input(file);
+        if (!input) {
+            throw simpleini::INIException("File not found:" + file.string());
+        }
+        simpleini::parse(input, reporter{ file, done });
+        return done;
+    });
+}
+
+int
+bench(std::span<char*> args)
+{
+    int runs = 10;
+    if (args.size() >= 2 && std::string_view(args[0]) == "-n") {
+        const std::string_view count = args[1];
+        auto [end, error] =
+          std::from_chars(count.data(), count.data() + count.size(), runs);
+        if (error != std::errc{} || end != count.data() + count.size() ||
+            runs < 1) {
+            std::cerr << usage;
+            return 2;
+        }
+        args = args.subspan(2);
+    }
+    if (args.empty()) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    struct counter
+    {
+        std::size_t keys = 0;
+        void on_key_value(std::string_view, std::string_view) { ++keys; }
+    };
+
+    using clock = std::chrono::steady_clock;
+    for (const char* arg : args) {
+        std::filesystem::path file(arg);
+        const double megabytes =
+          static_cast<double>(std::filesystem::file_size(file)) / 1e6;
+        auto measure = [&](auto&& parse_once) {
+            auto start = clock::now();
+            for (int i = 0; i < runs; ++i) {
+                parse_once();
+            }
+            std::chrono::duration<double> elapsed = clock::now() - start;
+            return megabytes * runs / elapsed.count();
+        };
+
+        counter keys;
+        double load = measure([&] { simpleini::SimpleINI config(file); });
+        double scan = measure([&] {
+            std::ifstream input(file);
+            simpleini::parse(input, keys);
+        });
+        std::cout << file.string() << ": " << megabytes << " MB, "
+                  << keys.keys / static_cast<std::size_t>(runs) << " keys, "
+                  << "load " << load << " MB/s, "
+                  << "scan " << scan << " MB/s\n";
+    }
+    return 0;
+}
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << usage;
+        return 2;
+    }
+    const std::string_view command = argv[1];
+    std::span<char*> args(argv + 2, static_cast<std::size_t>(argc - 2));
+
+    try {
+        if (command == "get") {
+            return get(args);
+        } else if (command == "list-sections") {
+            return list_sections(args);
+        } else if (command == "dump") {
+            return dump(args);
+        } else if (command == "diff") {
+            return diff(args);
+        } else if (command == "validate") {
+            return validate(args);
+        } else if (command == "bench") {
+            return bench(args);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "ini: " << error.what() << "\n";
+        return error_status;
+    }
+    std::cerr << usage;
+    return 2;
+}
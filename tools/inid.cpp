@@ -0,0 +1,40 @@
+#include <csignal>
+#include <iostream>
+
+#include <simpleini_server.h>
+
+namespace {
+simpleini::INIServer* running_server = nullptr;
+
+void
+handle_signal(int)
+{
+    if (running_server) {
+        running_server->stop();
+    }
+}
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <socket> <config.ini>\n"
+                  << "Serve lookups into config.ini over a Unix domain "
+                     "socket, reloading it when it changes.\n";
+        return 2;
+    }
+
+    try {
+        simpleini::INIServer server(argv[1], argv[2]);
+        running_server = &server;
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        server.run();
+        running_server = nullptr;
+    } catch (const std::exception& error) {
+        std::cerr << argv[0] << ": " << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}